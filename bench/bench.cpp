@@ -0,0 +1,403 @@
+#include "arta.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "alloc.hpp"
+#include "timer.hpp"
+
+static double time_reps(const unsigned& reps, const std::function<void()>& fn) {
+  fn();
+  arta::time::time_t start = arta::time::now();
+  for (unsigned i = 0; i < reps; ++i) {
+    fn();
+  }
+  return std::chrono::duration<double>(arta::time::now() - start).count() /
+         reps;
+}
+
+static void bench_spmv(arta::PDE& pde, const unsigned& reps,
+                       const unsigned& max_threads) {
+  const arta::linalg::Matrix& A = pde.M_;
+  arta::linalg::Vector x(A.size(), 1.0), y(A.size());
+  double flops = 2.0 * A.count();
+  double bytes = A.count() * (sizeof(double) + sizeof(unsigned long)) +
+                 (A.size() + 1) * sizeof(unsigned long) +
+                 2.0 * A.size() * sizeof(double);
+  printf("spmv: n=%lu nnz=%lu\n", A.size(), A.count());
+  printf("%8s %12s %12s %12s %12s\n", "threads", "time (us)", "GFLOP/s",
+         "GFLOP/s/core", "GB/s");
+  for (unsigned t = 1; t <= max_threads; ++t) {
+    arta::linalg::set_threads(t);
+    double sec = time_reps(reps, [&]() { arta::linalg::multiply(A, x, y); });
+    printf("%8u %12.3f %12.3f %12.3f %12.3f\n", t, sec * 1e6,
+           flops / sec * 1e-9, flops / sec * 1e-9 / t, bytes / sec * 1e-9);
+  }
+  arta::linalg::set_threads(max_threads);
+}
+
+static void bench_dot(arta::PDE& pde, const unsigned& reps,
+                      const unsigned& max_threads) {
+  unsigned long n = pde.M_.size();
+  arta::linalg::Vector x(n), y(n);
+  for (unsigned long i = 0; i < n; ++i) {
+    x[i] = std::sin(static_cast<double>(i));
+    y[i] = std::cos(static_cast<double>(i));
+  }
+  arta::linalg::set_threads(1);
+  double ref = arta::linalg::dot(x, y);
+  printf("dot: n=%lu block=%d\n", n, ARTA_BLAS_BLOCK);
+  printf("%8s %12s %12s %12s\n", "threads", "time (us)", "GB/s", "identical");
+  for (unsigned t = 1; t <= max_threads; ++t) {
+    arta::linalg::set_threads(t);
+    double val = 0.0;
+    double sec = time_reps(reps, [&]() { val = arta::linalg::dot(x, y); });
+    printf("%8u %12.3f %12.3f %12s\n", t, sec * 1e6,
+           2.0 * n * sizeof(double) / sec * 1e-9,
+           std::memcmp(&val, &ref, sizeof(double)) == 0 ? "yes" : "no");
+  }
+  arta::linalg::set_threads(max_threads);
+}
+
+static void bench_sell(arta::PDE& pde, const unsigned& reps,
+                       const unsigned& max_threads) {
+  const arta::linalg::Matrix& A = pde.M_;
+  arta::linalg::SellMatrix S(A);
+  arta::linalg::Vector x(A.size(), 1.0), y(A.size()), z(A.size());
+  double flops = 2.0 * A.count();
+  printf("sell: n=%lu nnz=%lu chunk=%d sigma=%d fill=%.3f kernel=%s\n",
+         A.size(), A.count(), ARTA_SELL_CHUNK, ARTA_SELL_SIGMA, S.fill(),
+         arta::linalg::SellMatrix::kernel().c_str());
+  printf("%8s %12s %12s %12s %12s %10s\n", "threads", "csr (us)", "sell (us)",
+         "csr GFLOP/s", "sell GFLOP/s", "speedup");
+  for (unsigned t = 1; t <= max_threads; t *= 2) {
+    arta::linalg::set_threads(t);
+    double csr = time_reps(reps, [&]() { arta::linalg::multiply(A, x, y); });
+    double sell = time_reps(reps, [&]() { arta::linalg::multiply(S, x, z); });
+    printf("%8u %12.3f %12.3f %12.3f %12.3f %10.3f\n", t, csr * 1e6,
+           sell * 1e6, flops / csr * 1e-9, flops / sell * 1e-9, csr / sell);
+  }
+  arta::linalg::set_threads(max_threads);
+}
+
+static void bench_sym(arta::PDE& pde, const unsigned& reps,
+                      const unsigned& max_threads) {
+  const arta::linalg::Matrix& A = pde.G_;
+  if (!arta::linalg::symmetric(A)) {
+    printf("sym: G is not symmetric, skipping\n");
+    return;
+  }
+  arta::linalg::SymMatrix S(A);
+  arta::linalg::Vector x(A.size(), 1.0), y(A.size()), z(A.size());
+  double index = sizeof(unsigned long), scalar = sizeof(double);
+  double full_bytes = A.count() * (scalar + index) + (A.size() + 1) * index;
+  double sym_bytes = S.count() * (scalar + index) + (A.size() + 1) * index;
+  printf("sym: n=%lu nnz=%lu stored=%lu csr=%.3fMB sym=%.3fMB\n", A.size(),
+         A.count(), S.count(), full_bytes * 1e-6, sym_bytes * 1e-6);
+  printf("%8s %12s %12s %12s %12s %10s\n", "threads", "csr (us)", "sym (us)",
+         "csr GB/s", "sym GB/s", "speedup");
+  for (unsigned t = 1; t <= max_threads; t *= 2) {
+    arta::linalg::set_threads(t);
+    double csr = time_reps(reps, [&]() { arta::linalg::multiply(A, x, y); });
+    double sym = time_reps(reps, [&]() { arta::linalg::multiply(S, x, z); });
+    printf("%8u %12.3f %12.3f %12.3f %12.3f %10.3f\n", t, csr * 1e6,
+           sym * 1e6, (full_bytes + 2.0 * A.size() * scalar) / csr * 1e-9,
+           (sym_bytes + 2.0 * A.size() * scalar) / sym * 1e-9, csr / sym);
+  }
+  arta::linalg::set_threads(max_threads);
+}
+
+static void bench_order(arta::PDE& pde, const unsigned& reps,
+                        const unsigned& max_threads) {
+  printf("order: n=%lu tris=%lu threads=%u\n", pde.mesh.pts.size(),
+         pde.mesh.tri.size(), max_threads);
+  printf("%8s %12s %12s %14s %12s\n", "order", "bandwidth", "reorder (ms)",
+         "assemble (us)", "spmv (us)");
+  for (std::string method : {"none", "rcm", "hilbert"}) {
+    arta::mesh::Mesh mesh(pde.mesh);
+    arta::time::time_t start = arta::time::now();
+    if (method != "none") {
+      mesh.reorder(method);
+    }
+    double reorder = std::chrono::duration<double>(arta::time::now() - start)
+                         .count();
+    auto pattern = std::make_shared<const arta::linalg::Pattern>(
+        mesh.pts.size(), mesh.tri);
+    arta::linalg::Matrix A(pattern);
+    std::vector<double>& vals = *A.get_vals();
+    double assemble = time_reps(reps, [&]() {
+      std::fill(vals.begin(), vals.end(), 0.0);
+      for (unsigned long e = 0; e < mesh.tri.size(); ++e) {
+        for (unsigned i = 0; i < 3; ++i) {
+          for (unsigned j = 0; j < 3; ++j) {
+            vals[pattern->slot(e, i, j)] += 1.0;
+          }
+        }
+      }
+    });
+    arta::linalg::Vector x(A.size(), 1.0), y(A.size());
+    double spmv = time_reps(reps, [&]() { arta::linalg::multiply(A, x, y); });
+    printf("%8s %12lu %12.3f %14.3f %12.3f\n", method.c_str(),
+           mesh.bandwidth(), reorder * 1e3, assemble * 1e6, spmv * 1e6);
+  }
+}
+
+static void bench_step(arta::PDE& pde, const unsigned& reps,
+                       const unsigned& max_threads) {
+  double dt = arta::script::getd({"dt", "deltat", "delta_t"});
+  pde.cache = false;
+  pde.construct_forcing(0.0);
+  printf("step: n=%lu dt=%g threads=%u\n", pde.mesh.pts.size(), dt,
+         max_threads);
+  printf("%8s %8s %12s %12s %10s %14s %14s %14s\n", "solver", "guess",
+         "init (ms)", "step (us)", "iters", "first allocs", "allocs/step",
+         "bytes/step");
+  // The script's solver from every initial guess, against a factorization
+  // reused by every step.
+  std::string script_solver = pde.solver.method;
+  std::string script_precond = pde.solver.precond;
+  std::string script_guess = pde.guess;
+  std::vector<std::pair<std::string, std::string>> runs;
+  if (script_solver != "direct") {
+    for (const char* guess : {"zero", "previous", "linear"}) {
+      runs.push_back({script_solver, guess});
+    }
+  }
+  runs.push_back({"direct", "zero"});
+  for (const auto& run : runs) {
+    const std::string& solver = run.first;
+    pde.solver.method = solver;
+    pde.solver.precond = solver == "direct" ? "direct" : script_precond;
+    pde.guess = run.second;
+    pde.construct_init();
+    arta::time::time_t start = arta::time::now();
+    pde.init_time_dep(dt);
+    double init = std::chrono::duration<double>(arta::time::now() - start)
+                      .count();
+    // The first step sizes the workspace, every later one should reuse it.
+    arta::alloc::Stats first = arta::alloc::total();
+    pde.step_time_dep(0);
+    arta::alloc::Stats warm = arta::alloc::total();
+    unsigned long iters = 0;
+    start = arta::time::now();
+    for (unsigned n = 1; n <= reps; ++n) {
+      pde.step_time_dep(n);
+      iters += pde.result.iterations;
+    }
+    double step =
+        std::chrono::duration<double>(arta::time::now() - start).count() /
+        reps;
+    arta::alloc::Stats end = arta::alloc::total();
+    std::string name = solver == "" ? "gmres" : solver;
+    printf("%8s %8s %12.3f %12.3f %10.2f", name.c_str(), run.second.c_str(),
+           init * 1e3, step * 1e6, static_cast<double>(iters) / reps);
+    if (arta::alloc::enabled()) {
+      printf(" %14lu %14.2f %14.2f\n", warm.count - first.count,
+             static_cast<double>(end.count - warm.count) / reps,
+             static_cast<double>(end.bytes - warm.bytes) / reps);
+    } else {
+      printf(" %14s %14s %14s\n", "n/a", "n/a", "n/a");
+    }
+  }
+  pde.solver.method = script_solver;
+  pde.solver.precond = script_precond;
+  pde.guess = script_guess;
+}
+
+static void bench_gs(arta::PDE& pde, const unsigned& reps,
+                     const unsigned& max_threads) {
+  arta::linalg::Matrix A(pde.M_);
+  pde.apply_bc(A);
+  arta::linalg::Vector b(A.size()), x(A.size()), ones(A.size(), 1.0);
+  arta::linalg::multiply(A, ones, b);
+  arta::linalg::Workspace ws(A.size());
+  arta::time::time_t start = arta::time::now();
+  arta::linalg::Coloring colors(A);
+  double coloring = std::chrono::duration<double>(arta::time::now() - start)
+                        .count();
+  // Sweeps to convergence, in row order and in color order.
+  arta::linalg::SolverOptions opts;
+  opts.max_iters = 100000;
+  unsigned serial = arta::linalg::gauss_seidel(A, b, x, ws, opts).iterations;
+  ws.reset();
+  unsigned colored =
+      arta::linalg::gauss_seidel(A, b, x, ws, colors, opts).iterations;
+  printf("gs: n=%lu nnz=%lu colors=%u coloring=%.3fms sweeps gs=%u mcgs=%u\n",
+         A.size(), A.count(), colors.colors(), coloring * 1e3, serial,
+         colored);
+  printf("%8s %12s %12s %10s\n", "threads", "gs (us)", "mcgs (us)",
+         "speedup");
+  // Time per sweep, the residual being checked once every ten.
+  const unsigned sweeps = 10;
+  opts.max_iters = sweeps;
+  opts.check = sweeps;
+  opts.rtol = 0.0;
+  double gs = time_reps(reps, [&]() {
+                ws.reset();
+                arta::linalg::gauss_seidel(A, b, x, ws, opts);
+              }) /
+              sweeps;
+  for (unsigned t = 1; t <= max_threads; t *= 2) {
+    arta::linalg::set_threads(t);
+    double mcgs = time_reps(reps, [&]() {
+                    ws.reset();
+                    arta::linalg::gauss_seidel(A, b, x, ws, colors, opts);
+                  }) /
+                  sweeps;
+    printf("%8u %12.3f %12.3f %10.3f\n", t, gs * 1e6, mcgs * 1e6,
+           gs / mcgs);
+  }
+  arta::linalg::set_threads(max_threads);
+}
+
+static void bench_precond(arta::PDE& pde, const unsigned& reps,
+                          const unsigned& max_threads) {
+  // The time independent system, with a right hand side of known solution.
+  arta::linalg::Matrix A(pde.M_);
+  pde.apply_bc(A);
+  arta::linalg::Vector b(A.size()), x(A.size()), ones(A.size(), 1.0);
+  arta::linalg::multiply(A, ones, b);
+  arta::linalg::Workspace ws(A.size());
+  printf("precond: n=%lu nnz=%lu symmetric=%s threads=%u\n", A.size(),
+         A.count(), arta::linalg::symmetric(A) ? "yes" : "no", max_threads);
+  printf("%8s %10s %12s %8s %12s %10s\n", "precond", "solver", "setup (ms)",
+         "iters", "solve (ms)", "error");
+  std::vector<std::string> names = {"none", "jacobi", "ilu0", "ic0",
+                                    "ssor", "amg", "direct"};
+  if (!pde.prolong_.empty()) {
+    names.push_back("gmg");
+  }
+  for (const std::string& name : names) {
+    auto M = pde.make_precond(name);
+    double setup = 0.0;
+    if (M) {
+      setup = time_reps(reps, [&]() { M->setup(A); });
+    }
+    for (std::string method :
+         {"gmres", "bicgstab", "cg", "mcgs", "amg", "gmg", "direct"}) {
+      // Multigrid and direct solves only run with their own hierarchy or
+      // factorization, multicolor Gauss-Seidel with the coloring of ssor.
+      if (((method == "amg" || method == "gmg" || method == "direct") &&
+           name != method) ||
+          (method == "mcgs" && name != "ssor")) {
+        continue;
+      }
+      arta::linalg::SolverOptions opts;
+      opts.method = method;
+      opts.max_iters = 10000;
+      unsigned iters = 0;
+      double solve = time_reps(reps, [&]() {
+        ws.reset();
+        iters = arta::linalg::solve(A, b, x, ws, opts, M.get()).iterations;
+      });
+      x -= ones;
+      printf("%8s %10s %12.3f %8u %12.3f %10.2e\n", name.c_str(),
+             method.c_str(), setup * 1e3, iters, solve * 1e3,
+             arta::linalg::nrm2(x) / arta::linalg::nrm2(ones));
+    }
+  }
+}
+
+static void bench_mixed(arta::PDE& pde, const unsigned& reps,
+                        const unsigned& max_threads) {
+  arta::linalg::Matrix A(pde.M_);
+  pde.apply_bc(A);
+  arta::linalg::Vector b(A.size()), x(A.size()), ones(A.size(), 1.0);
+  arta::linalg::multiply(A, ones, b);
+  arta::linalg::Workspace ws(A.size());
+  bool sym = arta::linalg::symmetric(A);
+  printf("mixed: n=%lu nnz=%lu symmetric=%s threads=%u\n", A.size(),
+         A.count(), sym ? "yes" : "no", max_threads);
+  printf("%10s %8s %6s %12s %8s %12s %10s\n", "solver", "precond", "prec",
+         "setup (ms)", "iters", "solve (ms)", "error");
+  std::vector<std::pair<std::string, std::string>> runs = {
+      {"gmres", "none"},    {"gmres", "ilu0"},    {"bicgstab", "none"},
+      {"bicgstab", "ilu0"}, {"direct", "direct"}};
+  if (sym) {
+    runs.push_back({"cg", "ic0"});
+  }
+  for (const auto& run : runs) {
+    for (bool mixed : {false, true}) {
+      arta::linalg::SolverOptions opts;
+      opts.method = run.first;
+      opts.precond = run.second;
+      opts.mixed = mixed;
+      opts.max_iters = 10000;
+      std::unique_ptr<arta::linalg::Preconditioner> M;
+      if (mixed) {
+        M.reset(new arta::linalg::MixedPrecision(
+            opts, run.first == "direct"
+                      ? nullptr
+                      : arta::linalg::make_preconditioner(run.second)));
+      } else {
+        M = arta::linalg::make_preconditioner(run.second);
+      }
+      double setup = 0.0;
+      if (M) {
+        setup = time_reps(reps, [&]() { M->setup(A); });
+      }
+      unsigned iters = 0;
+      double solve = time_reps(reps, [&]() {
+        ws.reset();
+        iters = arta::linalg::solve(A, b, x, ws, opts, M.get()).iterations;
+      });
+      x -= ones;
+      printf("%10s %8s %6s %12.3f %8u %12.3f %10.2e\n", run.first.c_str(),
+             run.second.c_str(), mixed ? "mixed" : "double", setup * 1e3,
+             iters, solve * 1e3,
+             arta::linalg::nrm2(x) / arta::linalg::nrm2(ones));
+    }
+  }
+}
+
+int main(int argc, char* argv[]) {
+  arta::argparse::Parser parser;
+  parser.add_flag('v', "verbose", "Enables verbose output");
+  parser.add_option('s', "script", "", "Script file to load");
+  parser.add_option('m', "mesh", "",
+                    "Mesh file to use instead of the script's");
+  parser.add_option('k', "suite", "all", "Benchmark suite to run");
+  parser.add_option('n', "reps", "100", "Repetitions per measurement");
+  parser.add_option('j', "threads", "0",
+                    "Maximum number of threads to sweep (0 for all cores)");
+  auto args = parser.parse_args(argc, argv);
+  if (!args.flags["verbose"]) {
+    arta::log::Console()->set_activation(arta::log::FATAL | arta::log::ERROR |
+                                         arta::log::WARNING);
+  }
+  unsigned max_threads = args.geti("threads") > 0
+                             ? args.geti("threads")
+                             : arta::linalg::get_threads();
+  unsigned reps = std::max(1, args.geti("reps"));
+
+  arta::PDE pde(args.options["script"], args.options["mesh"]);
+  pde.save = false;
+  pde.construct_matrices();
+
+  std::map<std::string,
+           std::function<void(arta::PDE&, const unsigned&, const unsigned&)>>
+      suites = {{"spmv", bench_spmv},
+                {"dot", bench_dot},
+                {"sell", bench_sell},
+                {"sym", bench_sym},
+                {"order", bench_order},
+                {"step", bench_step},
+                {"gs", bench_gs},
+                {"mixed", bench_mixed},
+                {"precond", bench_precond}};
+  for (auto& it : suites) {
+    if (args.options["suite"] == "all" || args.options["suite"] == it.first) {
+      it.second(pde, reps, max_threads);
+    }
+  }
+  return 0;
+}
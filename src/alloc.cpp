@@ -0,0 +1,90 @@
+#include "alloc.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include "logger.hpp"
+
+static std::atomic<unsigned long> count_(0), bytes_(0);
+static arta::alloc::Stats start_stats_ = {0, 0};
+
+#ifdef ARTA_COUNT_ALLOCS
+static void* counted_alloc(std::size_t size) {
+  count_.fetch_add(1, std::memory_order_relaxed);
+  bytes_.fetch_add(size, std::memory_order_relaxed);
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void* operator new(std::size_t size) { return counted_alloc(size); }
+void* operator new[](std::size_t size) { return counted_alloc(size); }
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+static void* counted_alloc(std::size_t size, std::align_val_t align) {
+  count_.fetch_add(1, std::memory_order_relaxed);
+  bytes_.fetch_add(size, std::memory_order_relaxed);
+  // aligned_alloc takes a non-zero multiple of the alignment.
+  std::size_t alignment = static_cast<std::size_t>(align);
+  std::size_t rounded = (std::max<std::size_t>(size, 1) + alignment - 1) /
+                        alignment * alignment;
+  void* ptr = std::aligned_alloc(alignment, rounded);
+  if (!ptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void* operator new(std::size_t size, std::align_val_t align) {
+  return counted_alloc(size, align);
+}
+void* operator new[](std::size_t size, std::align_val_t align) {
+  return counted_alloc(size, align);
+}
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+#endif
+
+bool arta::alloc::enabled() {
+#ifdef ARTA_COUNT_ALLOCS
+  return true;
+#else
+  return false;
+#endif
+}
+
+arta::alloc::Stats arta::alloc::total() {
+  return {count_.load(std::memory_order_relaxed),
+          bytes_.load(std::memory_order_relaxed)};
+}
+
+void arta::alloc::start() { start_stats_ = total(); }
+
+arta::alloc::Stats arta::alloc::stop() {
+  Stats now = total();
+  return {now.count - start_stats_.count, now.bytes - start_stats_.bytes};
+}
+
+void arta::alloc::report(const std::string& phase) {
+  if (enabled()) {
+    Stats stats = stop();
+    log::status("%s: %lu allocations, %lu bytes", phase.c_str(), stats.count,
+                stats.bytes);
+  }
+}
@@ -0,0 +1,28 @@
+#ifndef ARTA_ALLOC_HPP_
+#define ARTA_ALLOC_HPP_
+
+#include <string>
+
+namespace arta {
+namespace alloc {
+  struct Stats {
+    unsigned long count, bytes;
+  };
+
+  // Heap allocations are only counted when built with ARTA_COUNT_ALLOCS,
+  // which replaces the global operator new. Otherwise all counts are zero.
+  bool enabled();
+
+  // Allocations made since the program started.
+  Stats total();
+
+  // Allocations made between start() and stop(), in the style of
+  // time::start()/time::stop().
+  void start();
+  Stats stop();
+  // Logs the allocations since start() as a status line for phase.
+  void report(const std::string& phase);
+}  // namespace alloc
+}  // namespace arta
+
+#endif  // ARTA_ALLOC_HPP_
@@ -5,7 +5,7 @@
 
 #include "../mesh.hpp"
 
-const static double weights_[64] = {
+const double arta::calc::quad_weights[64] = {
     0.3335674062677772E-03, 0.7327880811491046E-03, 0.1033723454167925E-02,
     0.1195112498415193E-02, 0.1195112498415193E-02, 0.1033723454167925E-02,
     0.7327880811491046E-03, 0.3335674062677772E-03, 0.1806210919443461E-02,
@@ -29,7 +29,7 @@ const static double weights_[64] = {
     0.1615785427783403E-01, 0.1397588340693756E-01, 0.9907253959306707E-02,
     0.4509812715921713E-02};
 
-const static double pts_[128] = {
+const double arta::calc::quad_points[128] = {
     0.9553660447100000,     0.8862103848242247E-03, 0.9553660447100000,
     0.4537789678039195E-02, 0.9553660447100000,     0.1058868260117431E-01,
     0.9553660447100000,     0.1822327082910602E-01, 0.9553660447100000,
@@ -76,20 +76,5 @@ const static double pts_[128] = {
 
 double arta::calc::integrate(const std::function<double(double, double)>& func,
                              const unsigned& tri, const mesh::Mesh* mesh) {
-  double sum = 0.0;
-  double x1 = mesh->pts[mesh->tri[tri][0]].x,
-         y1 = mesh->pts[mesh->tri[tri][0]].y;
-  double x2 = mesh->pts[mesh->tri[tri][1]].x,
-         y2 = mesh->pts[mesh->tri[tri][1]].y;
-  double x3 = mesh->pts[mesh->tri[tri][2]].x,
-         y3 = mesh->pts[mesh->tri[tri][2]].y;
-  double area = fabs((x1 * (y2 - y3) + x2 * (y3 - y1) + x3 * (y1 - y2)) / 2.0);
-  for (unsigned i = 0; i < 64; ++i) {
-    sum +=
-        (weights_[i] * func(pts_[2 * i] * x1 + pts_[(2 * i) + 1] * x2 +
-                                (1.0 - pts_[2 * i] - pts_[(2 * i) + 1]) * x3,
-                            pts_[2 * i] * y1 + pts_[(2 * i) + 1] * y2 +
-                                (1.0 - pts_[2 * i] - pts_[(2 * i) + 1]) * y3));
-  }
-  return area * sum;
+  return integrate<std::function<double(double, double)>>(func, tri, mesh);
 }
@@ -1,11 +1,41 @@
 #ifndef ARTA_CALC_INTEGRATE_HPP_
 #define ARTA_CALC_INTEGRATE_HPP_
 
+#include <cmath>
 #include <functional>
+
 #include "../mesh.hpp"
 
 namespace arta {
 namespace calc {
+  // Weights and barycentric coordinates (two per point) of the 64 point
+  // quadrature rule used on every triangle.
+  extern const double quad_weights[64];
+  extern const double quad_points[128];
+
+  // Integrates any callable func(x, y) over triangle tri. Taking the
+  // callable directly avoids wrapping lambdas in a heap allocated
+  // std::function inside assembly loops.
+  template <typename _F>
+  double integrate(const _F& func, const unsigned& tri,
+                   const mesh::Mesh* mesh) {
+    double sum = 0.0;
+    double x1 = mesh->pts[mesh->tri[tri][0]].x,
+           y1 = mesh->pts[mesh->tri[tri][0]].y;
+    double x2 = mesh->pts[mesh->tri[tri][1]].x,
+           y2 = mesh->pts[mesh->tri[tri][1]].y;
+    double x3 = mesh->pts[mesh->tri[tri][2]].x,
+           y3 = mesh->pts[mesh->tri[tri][2]].y;
+    double area =
+        std::fabs((x1 * (y2 - y3) + x2 * (y3 - y1) + x3 * (y1 - y2)) / 2.0);
+    for (unsigned i = 0; i < 64; ++i) {
+      double a = quad_points[2 * i], b = quad_points[2 * i + 1];
+      sum += quad_weights[i] * func(a * x1 + b * x2 + (1.0 - a - b) * x3,
+                                    a * y1 + b * y2 + (1.0 - a - b) * y3);
+    }
+    return area * sum;
+  }
+
   double integrate(const std::function<double(double, double)>& func,
                    const unsigned& tri, const mesh::Mesh* mesh);
   double integrate(const std::function<double(double, double, double)>& func,
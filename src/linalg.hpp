@@ -1,9 +1,24 @@
 #ifndef ARTA_LINALG_HPP_
 #define ARTA_LINALG_HPP_
 
+#include "linalg/aligned.hpp"
+#include "linalg/binary.hpp"
+#include "linalg/blas.hpp"
+#include "linalg/coloring.hpp"
+#include "linalg/direct.hpp"
 #include "linalg/geometry.hpp"
 #include "linalg/vector.hpp"
 #include "linalg/matrix.hpp"
+#include "linalg/mixed.hpp"
+#include "linalg/multigrid.hpp"
+#include "linalg/operator.hpp"
+#include "linalg/parallel.hpp"
+#include "linalg/pattern.hpp"
+#include "linalg/precond.hpp"
+#include "linalg/sell.hpp"
 #include "linalg/solver.hpp"
+#include "linalg/sparse.hpp"
+#include "linalg/symmetric.hpp"
+#include "linalg/workspace.hpp"
 
 #endif  // ARTA_LINALG_HPP_
@@ -0,0 +1,44 @@
+#ifndef ARTA_LINALG_ALIGNED_HPP_
+#define ARTA_LINALG_ALIGNED_HPP_
+
+#include <cstddef>
+#include <new>
+
+#define ARTA_VECTOR_ALIGN 64
+
+namespace arta {
+namespace linalg {
+  // Allocator placing std::vector storage on ARTA_VECTOR_ALIGN byte
+  // boundaries, so vector data starts on a cache line and a full AVX-512
+  // register.
+  template <typename _T>
+  struct AlignedAllocator {
+    typedef _T value_type;
+
+    AlignedAllocator() noexcept {}
+    template <typename _U>
+    AlignedAllocator(const AlignedAllocator<_U>&) noexcept {}
+
+    _T* allocate(std::size_t n) {
+      return static_cast<_T*>(::operator new(
+          n * sizeof(_T), std::align_val_t(ARTA_VECTOR_ALIGN)));
+    }
+    void deallocate(_T* ptr, std::size_t) noexcept {
+      ::operator delete(ptr, std::align_val_t(ARTA_VECTOR_ALIGN));
+    }
+  };
+
+  template <typename _T, typename _U>
+  inline bool operator==(const AlignedAllocator<_T>&,
+                         const AlignedAllocator<_U>&) noexcept {
+    return true;
+  }
+  template <typename _T, typename _U>
+  inline bool operator!=(const AlignedAllocator<_T>&,
+                         const AlignedAllocator<_U>&) noexcept {
+    return false;
+  }
+}  // namespace linalg
+}  // namespace arta
+
+#endif  // ARTA_LINALG_ALIGNED_HPP_
@@ -0,0 +1,138 @@
+#include "binary.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../logger.hpp"
+
+std::uint64_t arta::linalg::checksum(const void* data, unsigned long bytes,
+                                     std::uint64_t seed) {
+  // FNV-1a over 64 bit words, with the tail folded in byte by byte.
+  const unsigned char* ptr = static_cast<const unsigned char*>(data);
+  std::uint64_t hash = seed;
+  unsigned long i = 0;
+  for (; i + 8 <= bytes; i += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, ptr + i, 8);
+    hash = (hash ^ word) * 1099511628211ull;
+  }
+  for (; i < bytes; ++i) {
+    hash = (hash ^ ptr[i]) * 1099511628211ull;
+  }
+  return hash;
+}
+
+arta::linalg::MappedFile::MappedFile() : data_(nullptr), size_(0) {}
+arta::linalg::MappedFile::MappedFile(const std::string& file_name)
+    : data_(nullptr), size_(0) {
+  int fd = open(file_name.c_str(), O_RDONLY);
+  if (fd == -1) {
+    log::warning("Failed to open file \"%s\"", file_name.c_str());
+    return;
+  }
+  struct stat st;
+  if (fstat(fd, &st) == 0 && st.st_size > 0) {
+    void* ptr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (ptr != MAP_FAILED) {
+      data_ = ptr;
+      size_ = st.st_size;
+    } else {
+      log::warning("Failed to map file \"%s\"", file_name.c_str());
+    }
+  }
+  close(fd);
+}
+arta::linalg::MappedFile::~MappedFile() {
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+}
+
+bool arta::linalg::write_binary(
+    const std::string& file_name, FileHeader header,
+    const std::vector<std::pair<const void*, unsigned long>>& arrays) {
+  FILE* out = fopen(file_name.c_str(), "wb");
+  if (!out) {
+    log::warning("Failed to open file \"%s\"", file_name.c_str());
+    return false;
+  }
+  header.version = ARTA_FILE_VERSION;
+  header.checksum = 14695981039346656037ull;
+  for (auto& it : arrays) {
+    header.checksum = checksum(it.first, it.second, header.checksum);
+  }
+  static const char zeros[ARTA_FILE_ALIGN] = {0};
+  bool ok = fwrite(&header, sizeof(FileHeader), 1, out) == 1;
+  unsigned long offset = sizeof(FileHeader);
+  for (auto& it : arrays) {
+    ok = ok && fwrite(zeros, 1, file_align(offset) - offset, out) ==
+                   file_align(offset) - offset;
+    offset = file_align(offset);
+    ok = ok && fwrite(it.first, 1, it.second, out) == it.second;
+    offset += it.second;
+  }
+  fclose(out);
+  if (!ok) {
+    log::warning("Failed to write file \"%s\"", file_name.c_str());
+  }
+  return ok;
+}
+
+bool arta::linalg::read_header(const MappedFile& file, const char* magic,
+                               const std::uint8_t& scalar_size,
+                               const std::uint8_t& index_size,
+                               FileHeader* header) {
+  if (!file.valid() || file.size() < sizeof(FileHeader)) {
+    return false;
+  }
+  std::memcpy(header, file.data(), sizeof(FileHeader));
+  if (std::memcmp(header->magic, magic, sizeof(header->magic)) != 0) {
+    log::warning("Unrecognized file format, expected \"%s\"", magic);
+    return false;
+  }
+  if (header->version != ARTA_FILE_VERSION) {
+    log::warning("Unsupported file version %u", header->version);
+    return false;
+  }
+  if (header->scalar_size != scalar_size || header->index_size != index_size) {
+    log::warning("File stores %u/%u byte scalars/indices, expected %u/%u",
+                 header->scalar_size, header->index_size, scalar_size,
+                 index_size);
+    return false;
+  }
+  return true;
+}
+
+bool arta::linalg::locate_arrays(const MappedFile& file,
+                                 const FileHeader& header,
+                                 const std::vector<unsigned long>& bytes,
+                                 std::vector<unsigned long>* offsets) {
+  offsets->clear();
+  unsigned long offset = sizeof(FileHeader);
+  std::uint64_t hash = 14695981039346656037ull;
+  for (auto& it : bytes) {
+    offset = file_align(offset);
+    if (offset + it > file.size() || offset + it < offset) {
+      log::warning("Truncated file, %lu of %lu bytes", file.size(),
+                   offset + it);
+      return false;
+    }
+    offsets->push_back(offset);
+    hash = checksum(file.data() + offset, it, hash);
+    offset += it;
+  }
+  if (hash != header.checksum) {
+    log::warning("Checksum mismatch");
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,69 @@
+#ifndef ARTA_LINALG_BINARY_HPP_
+#define ARTA_LINALG_BINARY_HPP_
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#define ARTA_FILE_VERSION 1
+#define ARTA_FILE_ALIGN 64
+
+namespace arta {
+namespace linalg {
+  // Fixed 64 byte header of the .mat/.vec cache files. The arrays follow it,
+  // each starting on an ARTA_FILE_ALIGN boundary so they can be used in place
+  // from a read-only mapping. The checksum covers the array bytes.
+  struct FileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint8_t scalar_size, index_size;
+    std::uint16_t flags;
+    std::uint64_t size, count, checksum;
+    std::uint8_t reserved[24];
+  };
+  static_assert(sizeof(FileHeader) == ARTA_FILE_ALIGN,
+                "FileHeader must fill one alignment block");
+
+  inline unsigned long file_align(unsigned long offset) {
+    return (offset + ARTA_FILE_ALIGN - 1) / ARTA_FILE_ALIGN * ARTA_FILE_ALIGN;
+  }
+
+  std::uint64_t checksum(const void* data, unsigned long bytes,
+                         std::uint64_t seed = 14695981039346656037ull);
+
+  class MappedFile {
+   public:
+    MappedFile();
+    explicit MappedFile(const std::string& file_name);
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    inline bool valid() const noexcept { return data_ != nullptr; }
+    inline unsigned long size() const noexcept { return size_; }
+    inline const char* data() const noexcept {
+      return static_cast<const char*>(data_);
+    }
+
+   private:
+    void* data_;
+    unsigned long size_;
+  };
+
+  bool write_binary(
+      const std::string& file_name, FileHeader header,
+      const std::vector<std::pair<const void*, unsigned long>>& arrays);
+  // Checks the magic, version and stored type sizes of a mapped file.
+  bool read_header(const MappedFile& file, const char* magic,
+                   const std::uint8_t& scalar_size,
+                   const std::uint8_t& index_size, FileHeader* header);
+  // Lays out arrays of the given byte lengths after the header, checks that
+  // they fit in the file and that the checksum matches.
+  bool locate_arrays(const MappedFile& file, const FileHeader& header,
+                     const std::vector<unsigned long>& bytes,
+                     std::vector<unsigned long>* offsets);
+}  // namespace linalg
+}  // namespace arta
+
+#endif  // ARTA_LINALG_BINARY_HPP_
@@ -0,0 +1,170 @@
+#include "blas.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "../logger.hpp"
+#include "parallel.hpp"
+#include "vector.hpp"
+
+namespace {
+#ifdef ARTA_CHECK_BOUNDS
+inline bool check_sizes(unsigned long a, unsigned long b) {
+  if (a != b) {
+    arta::log::warning("Vector size mismatch %lu != %lu", a, b);
+    return false;
+  }
+  return true;
+}
+#else
+inline bool check_sizes(unsigned long, unsigned long) { return true; }
+#endif
+
+// Sums x[i] * y[i] into ARTA_BLAS_LANES independent partial sums. Keeping the
+// lanes apart lets the compiler vectorize the loop without reordering any
+// single sum, so results do not depend on the instruction set.
+template <typename _T>
+_T lane_dot(const _T* x, const _T* y, unsigned long n) {
+  const unsigned long L = ARTA_BLAS_LANES;
+  _T acc[L] = {};
+  unsigned long i = 0;
+  for (; i + L <= n; i += L) {
+    for (unsigned long j = 0; j < L; ++j) {
+      acc[j] += x[i + j] * y[i + j];
+    }
+  }
+  for (unsigned long j = 0; i < n; ++i, ++j) {
+    acc[j] += x[i] * y[i];
+  }
+  for (unsigned long w = L / 2; w > 0; w /= 2) {
+    for (unsigned long j = 0; j < w; ++j) {
+      acc[j] += acc[j + w];
+    }
+  }
+  return acc[0];
+}
+
+// x . y over fixed blocks of ARTA_BLAS_BLOCK elements. Block sums are taken
+// with lane_dot, in parallel, and combined pairwise in a fixed order. The
+// blocking does not depend on the thread count, so neither does the result.
+template <typename _T>
+_T block_dot(const _T* x, const _T* y, unsigned long n) {
+  const unsigned long B = ARTA_BLAS_BLOCK;
+  unsigned long blocks = (n + B - 1) / B;
+  if (blocks <= 1) {
+    return lane_dot(x, y, n);
+  }
+  // Kept per calling thread, so repeated reductions do not allocate.
+  thread_local std::vector<_T> partial;
+  if (partial.size() < blocks) {
+    partial.resize(blocks);
+  }
+  _T* sums = partial.data();
+  arta::linalg::parallel_for(
+      0, blocks,
+      [=](unsigned long begin, unsigned long end) {
+        for (unsigned long b = begin; b < end; ++b) {
+          unsigned long first = b * B;
+          sums[b] = lane_dot(x + first, y + first, std::min(B, n - first));
+        }
+      },
+      ARTA_BLAS_GRAIN);
+  for (unsigned long w = 1; w < blocks; w *= 2) {
+    for (unsigned long b = 0; b + w < blocks; b += 2 * w) {
+      sums[b] += sums[b + w];
+    }
+  }
+  return sums[0];
+}
+}  // namespace
+
+template <typename _T>
+_T arta::linalg::dot(const BasicVector<_T>& x, const BasicVector<_T>& y) {
+  if (!check_sizes(x.size(), y.size())) {
+    return 0.0;
+  }
+  return block_dot(x.get_vals()->data(), y.get_vals()->data(), x.size());
+}
+template <typename _T>
+_T arta::linalg::nrm2(const BasicVector<_T>& x) {
+  const _T* xv = x.get_vals()->data();
+  return std::sqrt(block_dot(xv, xv, x.size()));
+}
+template <typename _T>
+_T arta::linalg::norm(const BasicVector<_T>& x) {
+  return nrm2(x);
+}
+
+template <typename _T>
+void arta::linalg::axpy(const typename BasicVector<_T>::value_type& alpha,
+                        const BasicVector<_T>& x, BasicVector<_T>& y) {
+  if (!check_sizes(x.size(), y.size())) {
+    return;
+  }
+  const _T* xv = x.get_vals()->data();
+  _T* yv = y.get_vals()->data();
+  for (unsigned long i = 0; i < x.size(); ++i) {
+    yv[i] += alpha * xv[i];
+  }
+}
+template <typename _T>
+void arta::linalg::axpby(const typename BasicVector<_T>::value_type& alpha,
+                         const BasicVector<_T>& x,
+                         const typename BasicVector<_T>::value_type& beta,
+                         BasicVector<_T>& y) {
+  if (!check_sizes(x.size(), y.size())) {
+    return;
+  }
+  const _T* xv = x.get_vals()->data();
+  _T* yv = y.get_vals()->data();
+  for (unsigned long i = 0; i < x.size(); ++i) {
+    yv[i] = alpha * xv[i] + beta * yv[i];
+  }
+}
+template <typename _T>
+void arta::linalg::scal(const typename BasicVector<_T>::value_type& alpha,
+                        BasicVector<_T>& x) {
+  _T* xv = x.get_vals()->data();
+  for (unsigned long i = 0; i < x.size(); ++i) {
+    xv[i] *= alpha;
+  }
+}
+template <typename _T>
+void arta::linalg::waxpby(const typename BasicVector<_T>::value_type& alpha,
+                          const BasicVector<_T>& x,
+                          const typename BasicVector<_T>::value_type& beta,
+                          const BasicVector<_T>& y, BasicVector<_T>& w) {
+  if (!check_sizes(x.size(), y.size())) {
+    return;
+  }
+  if (w.size() != x.size()) {
+    w = BasicVector<_T>(x.size());
+  }
+  const _T* xv = x.get_vals()->data();
+  const _T* yv = y.get_vals()->data();
+  _T* wv = w.get_vals()->data();
+  for (unsigned long i = 0; i < x.size(); ++i) {
+    wv[i] = alpha * xv[i] + beta * yv[i];
+  }
+}
+
+#define ARTA_INSTANTIATE_BLAS(_T)                                           \
+  template _T arta::linalg::dot(const BasicVector<_T>&,                     \
+                                const BasicVector<_T>&);                    \
+  template _T arta::linalg::nrm2(const BasicVector<_T>&);                   \
+  template _T arta::linalg::norm(const BasicVector<_T>&);                   \
+  template void arta::linalg::axpy(const BasicVector<_T>::value_type&,      \
+                                   const BasicVector<_T>&, BasicVector<_T>&); \
+  template void arta::linalg::axpby(                                        \
+      const BasicVector<_T>::value_type&, const BasicVector<_T>&,           \
+      const BasicVector<_T>::value_type&, BasicVector<_T>&);                \
+  template void arta::linalg::scal(const BasicVector<_T>::value_type&,      \
+                                   BasicVector<_T>&);                       \
+  template void arta::linalg::waxpby(                                       \
+      const BasicVector<_T>::value_type&, const BasicVector<_T>&,           \
+      const BasicVector<_T>::value_type&, const BasicVector<_T>&,           \
+      BasicVector<_T>&);
+
+ARTA_INSTANTIATE_BLAS(double)
+ARTA_INSTANTIATE_BLAS(float)
@@ -0,0 +1,54 @@
+#ifndef ARTA_LINALG_BLAS_HPP_
+#define ARTA_LINALG_BLAS_HPP_
+
+// Number of independent partial sums kept by the reductions, enough to fill
+// an AVX-512 register of doubles.
+#define ARTA_BLAS_LANES 8
+// Reductions are summed in blocks of this many elements, which are then
+// combined pairwise. Results only depend on the blocking, never on the
+// number of threads.
+#define ARTA_BLAS_BLOCK 4096
+// Minimum number of blocks worth handing to the thread pool.
+#define ARTA_BLAS_GRAIN 16
+
+namespace arta {
+namespace linalg {
+  template <typename _T>
+  class BasicVector;
+
+  // BLAS-1 kernels on the contiguous storage of BasicVector. Operand sizes
+  // are only checked when ARTA_CHECK_BOUNDS is defined (builds without
+  // NDEBUG), a mismatch is then reported and the call does nothing.
+
+  // x . y, threaded and bitwise reproducible across thread counts.
+  template <typename _T>
+  _T dot(const BasicVector<_T>& x, const BasicVector<_T>& y);
+  // ||x||_2
+  template <typename _T>
+  _T nrm2(const BasicVector<_T>& x);
+  template <typename _T>
+  _T norm(const BasicVector<_T>& x);
+  // y = alpha x + y
+  template <typename _T>
+  void axpy(const typename BasicVector<_T>::value_type& alpha,
+            const BasicVector<_T>& x, BasicVector<_T>& y);
+  // y = alpha x + beta y
+  template <typename _T>
+  void axpby(const typename BasicVector<_T>::value_type& alpha,
+             const BasicVector<_T>& x,
+             const typename BasicVector<_T>::value_type& beta,
+             BasicVector<_T>& y);
+  // x = alpha x
+  template <typename _T>
+  void scal(const typename BasicVector<_T>::value_type& alpha,
+            BasicVector<_T>& x);
+  // w = alpha x + beta y, w is resized if needed and may alias x or y.
+  template <typename _T>
+  void waxpby(const typename BasicVector<_T>::value_type& alpha,
+              const BasicVector<_T>& x,
+              const typename BasicVector<_T>::value_type& beta,
+              const BasicVector<_T>& y, BasicVector<_T>& w);
+}  // namespace linalg
+}  // namespace arta
+
+#endif  // ARTA_LINALG_BLAS_HPP_
@@ -0,0 +1,88 @@
+#include "coloring.hpp"
+
+#include <vector>
+
+#include "matrix.hpp"
+#include "parallel.hpp"
+#include "vector.hpp"
+
+arta::linalg::Coloring::Coloring() : color_ptr_(1, 0) {}
+
+arta::linalg::Coloring::Coloring(const Matrix& A) : color_ptr_(1, 0) {
+  const std::vector<unsigned long>& row_ptr = *A.get_row_ptr();
+  const std::vector<unsigned long>& col_ind = *A.get_col_ind();
+  unsigned long n = A.size();
+  // Columns of A, which are the rows of A^T.
+  std::vector<unsigned long> col_ptr(n + 1, 0), row_ind(col_ind.size());
+  for (unsigned long k = 0; k < row_ptr[n]; ++k) {
+    col_ptr[col_ind[k] + 1]++;
+  }
+  for (unsigned long j = 0; j < n; ++j) {
+    col_ptr[j + 1] += col_ptr[j];
+  }
+  std::vector<unsigned long> next(col_ptr.begin(), col_ptr.end() - 1);
+  for (unsigned long i = 0; i < n; ++i) {
+    for (unsigned long k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+      row_ind[next[col_ind[k]]++] = i;
+    }
+  }
+  // Every row takes the smallest color no neighbour has taken yet.
+  // used[c] holds the last row that saw a neighbour of color c, so the
+  // marks never need clearing.
+  const unsigned long none = static_cast<unsigned long>(-1);
+  std::vector<unsigned> color(n);
+  std::vector<unsigned long> used;
+  for (unsigned long i = 0; i < n; ++i) {
+    for (unsigned long k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+      if (col_ind[k] < i) used[color[col_ind[k]]] = i;
+    }
+    for (unsigned long k = col_ptr[i]; k < col_ptr[i + 1]; ++k) {
+      if (row_ind[k] < i) used[color[row_ind[k]]] = i;
+    }
+    unsigned c = 0;
+    while (c < used.size() && used[c] == i) ++c;
+    if (c == used.size()) used.push_back(none);
+    color[i] = c;
+  }
+  color_ptr_.assign(used.size() + 1, 0);
+  for (unsigned long i = 0; i < n; ++i) {
+    color_ptr_[color[i] + 1]++;
+  }
+  for (unsigned c = 0; c < used.size(); ++c) {
+    color_ptr_[c + 1] += color_ptr_[c];
+  }
+  rows_.resize(n);
+  next.assign(color_ptr_.begin(), color_ptr_.end() - 1);
+  for (unsigned long i = 0; i < n; ++i) {
+    rows_[next[color[i]]++] = i;
+  }
+}
+
+void arta::linalg::multicolor_sweep(const Matrix& A, const Vector& b,
+                                    Vector& x, const Coloring& c,
+                                    const double* dinv, const double& omega,
+                                    bool backward) {
+  const unsigned long* row_ptr = A.get_row_ptr()->data();
+  const unsigned long* col_ind = A.get_col_ind()->data();
+  const double* vals = A.get_vals()->data();
+  const double* bv = b.get_vals()->data();
+  double* xv = x.get_vals()->data();
+  double w = omega;
+  for (unsigned j = 0; j < c.colors(); ++j) {
+    unsigned color = backward ? c.colors() - 1 - j : j;
+    const unsigned long* rows = c.rows(color);
+    arta::linalg::parallel_for(
+        0, c.count(color),
+        [=](unsigned long begin, unsigned long end) {
+          for (unsigned long r = begin; r < end; ++r) {
+            unsigned long i = rows[r];
+            double sum = bv[i];
+            for (unsigned long k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+              sum -= vals[k] * xv[col_ind[k]];
+            }
+            xv[i] += w * sum * dinv[i];
+          }
+        },
+        ARTA_COLOR_GRAIN);
+  }
+}
@@ -0,0 +1,48 @@
+#ifndef ARTA_LINALG_COLORING_HPP_
+#define ARTA_LINALG_COLORING_HPP_
+
+#include <vector>
+
+#include "matrix.hpp"
+#include "vector.hpp"
+
+// Rows of one color handed to a thread at a time by the colored sweeps.
+#define ARTA_COLOR_GRAIN 256
+
+namespace arta {
+namespace linalg {
+  // Greedy coloring of the graph of A + A^T, in row order. No two rows of
+  // one color share an entry of A, so a Gauss-Seidel sweep can update all
+  // rows of a color at once. Finite element matrices need a handful of
+  // colors, bounded by one more than the largest row.
+  class Coloring {
+   public:
+    Coloring();
+    explicit Coloring(const Matrix& A);
+
+    inline unsigned colors() const noexcept { return color_ptr_.size() - 1; }
+    inline unsigned long size() const noexcept { return rows_.size(); }
+    // Rows of color c, ascending, are rows(c)[0, count(c)).
+    inline const unsigned long* rows(unsigned c) const {
+      return rows_.data() + color_ptr_[c];
+    }
+    inline unsigned long count(unsigned c) const {
+      return color_ptr_[c + 1] - color_ptr_[c];
+    }
+
+   private:
+    std::vector<unsigned long> color_ptr_, rows_;
+  };
+
+  // One sweep x_i += omega (b_i - A_i x) / a_ii over the colors of c, in
+  // reverse color order when backward, the rows of each color split across
+  // the linalg thread pool. dinv holds 1 / a_ii. The result does not depend
+  // on the number of threads, and a forward sweep followed by a backward
+  // one is symmetric.
+  void multicolor_sweep(const Matrix& A, const Vector& b, Vector& x,
+                        const Coloring& c, const double* dinv,
+                        const double& omega, bool backward);
+}  // namespace linalg
+}  // namespace arta
+
+#endif  // ARTA_LINALG_COLORING_HPP_
@@ -0,0 +1,490 @@
+#include "direct.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "../logger.hpp"
+#include "matrix.hpp"
+#include "sparse.hpp"
+#include "symmetric.hpp"
+#include "vector.hpp"
+
+std::vector<unsigned long> arta::linalg::amd_order(const Matrix& A) {
+  const std::vector<unsigned long>& row_ptr = *A.get_row_ptr();
+  const std::vector<unsigned long>& col_ind = *A.get_col_ind();
+  unsigned long n = A.size();
+  // Every vertex starts as a variable adjacent to variables. Eliminating one
+  // turns it into an element holding the variables it couples, and absorbs
+  // the elements adjacent to it.
+  enum State : unsigned char { VARIABLE, ELEMENT, ABSORBED };
+  std::vector<std::vector<unsigned long>> vars(n), elems(n), members(n);
+  for (unsigned long i = 0; i < n; ++i) {
+    for (unsigned long k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+      if (col_ind[k] != i) {
+        vars[i].push_back(col_ind[k]);
+        vars[col_ind[k]].push_back(i);
+      }
+    }
+  }
+  // Variables by degree, in doubly linked lists ended by n.
+  std::vector<unsigned long> degree(n), head(n + 1, n), next(n), prev(n);
+  unsigned long min_degree = n;
+  auto insert = [&](unsigned long i, unsigned long d) {
+    degree[i] = d;
+    next[i] = head[d];
+    prev[i] = n;
+    if (head[d] != n) prev[head[d]] = i;
+    head[d] = i;
+    min_degree = std::min(min_degree, d);
+  };
+  auto remove = [&](unsigned long i) {
+    if (prev[i] != n) {
+      next[prev[i]] = next[i];
+    } else {
+      head[degree[i]] = next[i];
+    }
+    if (next[i] != n) prev[next[i]] = prev[i];
+  };
+  for (unsigned long i = 0; i < n; ++i) {
+    std::sort(vars[i].begin(), vars[i].end());
+    vars[i].erase(std::unique(vars[i].begin(), vars[i].end()), vars[i].end());
+    insert(i, vars[i].size());
+  }
+  std::vector<State> state(n, VARIABLE);
+  std::vector<unsigned long> mark(n, 0), wmark(n, 0), lp, order;
+  std::vector<long> w(n, 0);
+  order.reserve(n);
+  for (unsigned long tag = 1; order.size() < n; ++tag) {
+    while (head[min_degree] == n) {
+      min_degree++;
+    }
+    unsigned long p = head[min_degree];
+    remove(p);
+    order.push_back(p);
+    state[p] = ELEMENT;
+    mark[p] = tag;
+    // The variables of the new element, adjacent to p directly or through
+    // the elements it absorbs.
+    lp.clear();
+    for (unsigned long v : vars[p]) {
+      if (state[v] == VARIABLE && mark[v] != tag) {
+        mark[v] = tag;
+        lp.push_back(v);
+      }
+    }
+    for (unsigned long e : elems[p]) {
+      if (state[e] != ELEMENT) continue;
+      for (unsigned long v : members[e]) {
+        if (state[v] == VARIABLE && mark[v] != tag) {
+          mark[v] = tag;
+          lp.push_back(v);
+        }
+      }
+      state[e] = ABSORBED;
+      std::vector<unsigned long>().swap(members[e]);
+    }
+    std::vector<unsigned long>().swap(vars[p]);
+    std::vector<unsigned long>().swap(elems[p]);
+    members[p] = lp;
+    // w[e] = |L_e \ L_p| for the other elements adjacent to L_p.
+    for (unsigned long i : lp) {
+      for (unsigned long e : elems[i]) {
+        if (state[e] != ELEMENT) continue;
+        if (wmark[e] != tag) {
+          wmark[e] = tag;
+          std::vector<unsigned long>& le = members[e];
+          le.erase(std::remove_if(le.begin(), le.end(),
+                                  [&](unsigned long v) {
+                                    return state[v] != VARIABLE;
+                                  }),
+                   le.end());
+          w[e] = le.size();
+        }
+        w[e]--;
+      }
+    }
+    // Approximate external degree of every variable of L_p, the bound
+    // |A_i \ L_p| + |L_p \ i| + sum |L_e \ L_p|. Elements entirely inside
+    // L_p are absorbed as well.
+    unsigned long left = n - order.size();
+    for (unsigned long i : lp) {
+      unsigned long deg = lp.size() - 1;
+      std::vector<unsigned long>& ei = elems[i];
+      unsigned long kept = 0;
+      for (unsigned long e : ei) {
+        if (state[e] != ELEMENT) continue;
+        if (w[e] == 0) {
+          state[e] = ABSORBED;
+          std::vector<unsigned long>().swap(members[e]);
+          continue;
+        }
+        deg += w[e];
+        ei[kept++] = e;
+      }
+      ei.resize(kept);
+      ei.push_back(p);
+      std::vector<unsigned long>& vi = vars[i];
+      vi.erase(std::remove_if(vi.begin(), vi.end(),
+                              [&](unsigned long v) {
+                                return state[v] != VARIABLE || mark[v] == tag;
+                              }),
+               vi.end());
+      remove(i);
+      insert(i, std::min(deg + vi.size(), left - 1));
+    }
+  }
+  return order;
+}
+
+arta::linalg::Direct::Direct(bool single) : single_(single) {}
+
+void arta::linalg::Direct::setup(const Matrix& A) {
+  const std::vector<unsigned long>& row_ptr = *A.get_row_ptr();
+  const std::vector<unsigned long>& col_ind = *A.get_col_ind();
+  const std::vector<double>& vals = *A.get_vals();
+  unsigned long n = A.size();
+  size_ = n;
+  // Rows holding only their diagonal, the Dirichlet rows of a boundary
+  // condition, are known from b alone. Their columns are moved to the right
+  // hand side, which leaves a symmetric system symmetric once the boundary
+  // rows are imposed, and stored zeros are dropped so they cause no fill.
+  std::vector<double> fixed(n, 0.0);
+  for (unsigned long i = 0; i < n; ++i) {
+    unsigned long count = 0;
+    for (unsigned long k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+      if (vals[k] == 0.0) continue;
+      count++;
+      if (col_ind[k] == i) fixed[i] = vals[k];
+    }
+    if (count != 1) fixed[i] = 0.0;
+  }
+  std::vector<unsigned long> r_ptr(n + 1, 0), r_ind;
+  std::vector<double> r_vals;
+  r_ind.reserve(col_ind.size());
+  r_vals.reserve(col_ind.size());
+  moved_row_.clear();
+  moved_col_.clear();
+  moved_vals_.clear();
+  for (unsigned long i = 0; i < n; ++i) {
+    for (unsigned long k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+      unsigned long j = col_ind[k];
+      if (vals[k] == 0.0) continue;
+      if (j != i && fixed[j] != 0.0) {
+        moved_row_.push_back(i);
+        moved_col_.push_back(j);
+        moved_vals_.push_back(vals[k] / fixed[j]);
+      } else {
+        r_ind.push_back(j);
+        r_vals.push_back(vals[k]);
+      }
+    }
+    r_ptr[i + 1] = r_ind.size();
+  }
+  Matrix R(n, std::move(r_ptr), std::move(r_ind), std::move(r_vals));
+  q_ = amd_order(R);
+  cholesky_ = symmetric(R) && factor_cholesky(R);
+  if (!cholesky_) {
+    factor_lu(R);
+  } else {
+    p_ = q_;
+    u_ptr_.clear();
+    u_ind_.clear();
+    u_vals_.clear();
+  }
+  // Moved entries are subtracted from the permuted right hand side.
+  std::vector<unsigned long> pinv(n);
+  for (unsigned long k = 0; k < n; ++k) {
+    pinv[p_[k]] = k;
+  }
+  for (unsigned long& r : moved_row_) {
+    r = pinv[r];
+  }
+  l_valsf_.clear();
+  u_valsf_.clear();
+  if (single_) {
+    l_valsf_.assign(l_vals_.begin(), l_vals_.end());
+    u_valsf_.assign(u_vals_.begin(), u_vals_.end());
+    std::vector<double>().swap(l_vals_);
+    std::vector<double>().swap(u_vals_);
+  }
+  work_.assign(n, 0.0);
+}
+
+bool arta::linalg::Direct::factor_cholesky(const Matrix& A) {
+  const std::vector<unsigned long>& row_ptr = *A.get_row_ptr();
+  const std::vector<unsigned long>& col_ind = *A.get_col_ind();
+  const std::vector<double>& vals = *A.get_vals();
+  unsigned long n = A.size();
+  std::vector<unsigned long> pinv(n);
+  for (unsigned long k = 0; k < n; ++k) {
+    pinv[q_[k]] = k;
+  }
+  // Lower triangle of C = P A P^T by rows.
+  std::vector<unsigned long> c_ptr(n + 1, 0), c_ind;
+  std::vector<double> c_vals;
+  c_ind.reserve(col_ind.size() / 2 + n);
+  c_vals.reserve(col_ind.size() / 2 + n);
+  for (unsigned long k = 0; k < n; ++k) {
+    unsigned long i = q_[k];
+    for (unsigned long p = row_ptr[i]; p < row_ptr[i + 1]; ++p) {
+      if (pinv[col_ind[p]] <= k) {
+        c_ind.push_back(pinv[col_ind[p]]);
+        c_vals.push_back(vals[p]);
+      }
+    }
+    c_ptr[k + 1] = c_ind.size();
+  }
+  // Elimination tree, n marking roots.
+  std::vector<unsigned long> parent(n, n), ancestor(n, n);
+  for (unsigned long k = 0; k < n; ++k) {
+    for (unsigned long p = c_ptr[k]; p < c_ptr[k + 1]; ++p) {
+      // Climbs to the root of the subtree of c_ind[p], compressing the
+      // path to k on the way.
+      for (unsigned long i = c_ind[p]; i < k;) {
+        unsigned long next = ancestor[i];
+        ancestor[i] = k;
+        if (next == n) {
+          parent[i] = k;
+          break;
+        }
+        i = next;
+      }
+    }
+  }
+  // The pattern of row k of L is the reach of row k of C in the tree, left
+  // in stack[top, n) with every column before its ancestors.
+  std::vector<unsigned long> flag(n, n), stack(n);
+  auto reach = [&](unsigned long k) {
+    unsigned long top = n;
+    flag[k] = k;
+    for (unsigned long p = c_ptr[k]; p < c_ptr[k + 1]; ++p) {
+      unsigned long len = 0;
+      for (unsigned long i = c_ind[p]; flag[i] != k; i = parent[i]) {
+        stack[len++] = i;
+        flag[i] = k;
+      }
+      while (len > 0) {
+        stack[--top] = stack[--len];
+      }
+    }
+    return top;
+  };
+  std::vector<unsigned long> next(n, 1);
+  for (unsigned long k = 0; k < n; ++k) {
+    for (unsigned long top = reach(k); top < n; ++top) {
+      next[stack[top]]++;
+    }
+  }
+  l_ptr_.assign(n + 1, 0);
+  for (unsigned long k = 0; k < n; ++k) {
+    l_ptr_[k + 1] = l_ptr_[k] + next[k];
+    next[k] = l_ptr_[k];
+  }
+  l_ind_.resize(l_ptr_[n]);
+  l_vals_.resize(l_ptr_[n]);
+  // Up-looking: row k of L solves L(0:k, 0:k) l = C(0:k, k).
+  std::vector<double> x(n, 0.0);
+  std::fill(flag.begin(), flag.end(), n);
+  for (unsigned long k = 0; k < n; ++k) {
+    unsigned long top = reach(k);
+    for (unsigned long p = c_ptr[k]; p < c_ptr[k + 1]; ++p) {
+      x[c_ind[p]] = c_vals[p];
+    }
+    double d = x[k];
+    x[k] = 0.0;
+    for (; top < n; ++top) {
+      unsigned long j = stack[top];
+      double lkj = x[j] / l_vals_[l_ptr_[j]];
+      x[j] = 0.0;
+      for (unsigned long p = l_ptr_[j] + 1; p < next[j]; ++p) {
+        x[l_ind_[p]] -= l_vals_[p] * lkj;
+      }
+      d -= lkj * lkj;
+      l_ind_[next[j]] = k;
+      l_vals_[next[j]++] = lkj;
+    }
+    if (d <= 0.0) {
+      l_ptr_.clear();
+      l_ind_.clear();
+      l_vals_.clear();
+      return false;
+    }
+    l_ind_[next[k]] = k;
+    l_vals_[next[k]++] = std::sqrt(d);
+  }
+  return true;
+}
+
+bool arta::linalg::Direct::factor_lu(const Matrix& A) {
+  // Left-looking Gilbert-Peierls: column k of L and U is a sparse
+  // triangular solve with the columns already factored, its pattern found
+  // by a depth first search through them.
+  SparseMatrix C = transpose(SparseMatrix(A));
+  unsigned long n = A.size();
+  const long none = -1;
+  std::vector<long> pinv(n, none);
+  l_ptr_.assign(n + 1, 0);
+  u_ptr_.assign(n + 1, 0);
+  l_ind_.clear();
+  l_vals_.clear();
+  u_ind_.clear();
+  u_vals_.clear();
+  l_ind_.reserve(4 * C.count());
+  l_vals_.reserve(4 * C.count());
+  u_ind_.reserve(4 * C.count());
+  u_vals_.reserve(4 * C.count());
+  std::vector<double> x(n, 0.0);
+  std::vector<unsigned long> xi(n), stack(n), pstack(n), mark(n, 0);
+  unsigned long zero_pivots = 0;
+  for (unsigned long k = 0; k < n; ++k) {
+    l_ptr_[k] = l_ind_.size();
+    u_ptr_[k] = u_ind_.size();
+    unsigned long col = q_[k], top = n;
+    for (unsigned long p = C.row_ptr[col]; p < C.row_ptr[col + 1]; ++p) {
+      if (mark[C.col_ind[p]] == k + 1) continue;
+      long head = 0;
+      stack[0] = C.col_ind[p];
+      while (head >= 0) {
+        unsigned long j = stack[head];
+        long J = pinv[j];
+        if (mark[j] != k + 1) {
+          mark[j] = k + 1;
+          pstack[head] = J == none ? 0 : l_ptr_[J] + 1;
+        }
+        unsigned long end = J == none ? 0 : l_ptr_[J + 1];
+        bool done = true;
+        for (unsigned long q = pstack[head]; q < end; ++q) {
+          if (mark[l_ind_[q]] == k + 1) continue;
+          pstack[head] = q + 1;
+          stack[++head] = l_ind_[q];
+          done = false;
+          break;
+        }
+        if (done) {
+          head--;
+          xi[--top] = j;
+        }
+      }
+    }
+    for (unsigned long p = C.row_ptr[col]; p < C.row_ptr[col + 1]; ++p) {
+      x[C.col_ind[p]] = C.vals[p];
+    }
+    for (unsigned long px = top; px < n; ++px) {
+      unsigned long j = xi[px];
+      if (pinv[j] == none) continue;
+      for (unsigned long p = l_ptr_[pinv[j]] + 1; p < l_ptr_[pinv[j] + 1];
+           ++p) {
+        x[l_ind_[p]] -= l_vals_[p] * x[j];
+      }
+    }
+    unsigned long ipiv = n;
+    double largest = -1.0;
+    for (unsigned long px = top; px < n; ++px) {
+      unsigned long i = xi[px];
+      if (pinv[i] == none) {
+        if (std::fabs(x[i]) > largest) {
+          largest = std::fabs(x[i]);
+          ipiv = i;
+        }
+      } else {
+        u_ind_.push_back(pinv[i]);
+        u_vals_.push_back(x[i]);
+      }
+    }
+    if (pinv[col] == none &&
+        std::fabs(x[col]) >= ARTA_DIRECT_PIVOT_TOL * largest) {
+      ipiv = col;
+    }
+    if (ipiv == n) {
+      // Structurally singular, any remaining row will do.
+      ipiv = std::find(pinv.begin(), pinv.end(), none) - pinv.begin();
+    }
+    double pivot = x[ipiv];
+    if (pivot == 0.0) {
+      pivot = 1.0;
+      zero_pivots++;
+    }
+    u_ind_.push_back(k);
+    u_vals_.push_back(pivot);
+    pinv[ipiv] = k;
+    l_ind_.push_back(ipiv);
+    l_vals_.push_back(1.0);
+    for (unsigned long px = top; px < n; ++px) {
+      unsigned long i = xi[px];
+      if (pinv[i] == none) {
+        l_ind_.push_back(i);
+        l_vals_.push_back(x[i] / pivot);
+      }
+      x[i] = 0.0;
+    }
+  }
+  l_ptr_[n] = l_ind_.size();
+  u_ptr_[n] = u_ind_.size();
+  p_.resize(n);
+  for (unsigned long i = 0; i < n; ++i) {
+    p_[pinv[i]] = i;
+  }
+  for (unsigned long& i : l_ind_) {
+    i = pinv[i];
+  }
+  if (zero_pivots != 0) {
+    log::warning("LU replaced %lu zero pivots of a singular matrix",
+                 zero_pivots);
+  }
+  return zero_pivots == 0;
+}
+
+void arta::linalg::Direct::apply(const Vector& b, Vector& x) const {
+  const double* bv = b.get_vals()->data();
+  double* xv = x.get_vals()->data();
+  double* w = work_.data();
+  unsigned long n = size_;
+  for (unsigned long k = 0; k < n; ++k) {
+    w[k] = bv[p_[k]];
+  }
+  for (unsigned long k = 0; k < moved_vals_.size(); ++k) {
+    w[moved_row_[k]] -= moved_vals_[k] * bv[moved_col_[k]];
+  }
+  if (single_) {
+    triangular_solves(l_valsf_.data(), u_valsf_.data(), w);
+  } else {
+    triangular_solves(l_vals_.data(), u_vals_.data(), w);
+  }
+  for (unsigned long k = 0; k < n; ++k) {
+    xv[q_[k]] = w[k];
+  }
+}
+
+template <typename _T>
+void arta::linalg::Direct::triangular_solves(const _T* l_vals,
+                                             const _T* u_vals,
+                                             double* w) const {
+  unsigned long n = size_;
+  if (cholesky_) {
+    for (unsigned long j = 0; j < n; ++j) {
+      w[j] /= l_vals[l_ptr_[j]];
+      for (unsigned long p = l_ptr_[j] + 1; p < l_ptr_[j + 1]; ++p) {
+        w[l_ind_[p]] -= l_vals[p] * w[j];
+      }
+    }
+    for (unsigned long j = n; j-- > 0;) {
+      for (unsigned long p = l_ptr_[j] + 1; p < l_ptr_[j + 1]; ++p) {
+        w[j] -= l_vals[p] * w[l_ind_[p]];
+      }
+      w[j] /= l_vals[l_ptr_[j]];
+    }
+  } else {
+    for (unsigned long j = 0; j < n; ++j) {
+      for (unsigned long p = l_ptr_[j] + 1; p < l_ptr_[j + 1]; ++p) {
+        w[l_ind_[p]] -= l_vals[p] * w[j];
+      }
+    }
+    for (unsigned long j = n; j-- > 0;) {
+      w[j] /= u_vals[u_ptr_[j + 1] - 1];
+      for (unsigned long p = u_ptr_[j]; p < u_ptr_[j + 1] - 1; ++p) {
+        w[u_ind_[p]] -= u_vals[p] * w[j];
+      }
+    }
+  }
+}
@@ -0,0 +1,72 @@
+#ifndef ARTA_LINALG_DIRECT_HPP_
+#define ARTA_LINALG_DIRECT_HPP_
+
+#include <vector>
+
+#include "matrix.hpp"
+#include "precond.hpp"
+#include "vector.hpp"
+
+// A pivot is kept on the diagonal while it is at least this fraction of the
+// largest candidate in its column, which preserves the fill-reducing order.
+#define ARTA_DIRECT_PIVOT_TOL 0.1
+
+namespace arta {
+namespace linalg {
+  // Approximate minimum degree ordering of the graph of A + A^T, as a new to
+  // old index map. Eliminated vertices are kept as elements of a quotient
+  // graph, so the ordering runs in about the space of A.
+  std::vector<unsigned long> amd_order(const Matrix& A);
+
+  // Sparse direct factorization, P A P^T = L L^T for symmetric positive
+  // definite A and otherwise A(p, q) = L U with partial pivoting, both on
+  // the amd_order of A. Rows holding only a diagonal entry are eliminated
+  // first, so Dirichlet rows do not rule out Cholesky. setup() factors A,
+  // after which apply(b, x) solves A x = b exactly with two triangular
+  // solves, so a factorization can be reused for every system sharing the
+  // matrix. A single precision Direct factors in double but keeps the
+  // factors as floats, halving the memory the solves stream, for iterative
+  // refinement (see mixed.hpp).
+  class Direct final : public Preconditioner {
+   public:
+    explicit Direct(bool single = false);
+
+    void setup(const Matrix& A) override;
+    // Not safe to call concurrently, the solves share one work vector.
+    void apply(const Vector& b, Vector& x) const override;
+
+    inline bool cholesky() const noexcept { return cholesky_; }
+    // Stored entries of the factors.
+    inline unsigned long factor_count() const noexcept {
+      return l_ind_.size() + u_ind_.size();
+    }
+
+   private:
+    bool factor_cholesky(const Matrix& A);
+    bool factor_lu(const Matrix& A);
+    // Solves with L and U (L^T for Cholesky) in place on w, whose rows
+    // are permuted by p_.
+    template <typename _T>
+    void triangular_solves(const _T* l_vals, const _T* u_vals,
+                           double* w) const;
+
+    bool single_, cholesky_ = false;
+    // Column order q and row order p, as new to old maps, equal for
+    // Cholesky.
+    std::vector<unsigned long> q_, p_;
+    // Entries in the columns of eliminated rows, by permuted row, scaled by
+    // the inverse diagonal of their column.
+    std::vector<unsigned long> moved_row_, moved_col_;
+    std::vector<double> moved_vals_;
+    // L and U by columns, the diagonal first in every column of L and last
+    // in every column of U. L is unit lower triangular for LU.
+    std::vector<unsigned long> l_ptr_, l_ind_, u_ptr_, u_ind_;
+    std::vector<double> l_vals_, u_vals_;
+    // The factors rounded to single precision, replacing the above.
+    std::vector<float> l_valsf_, u_valsf_;
+    mutable std::vector<double> work_;
+  };
+}  // namespace linalg
+}  // namespace arta
+
+#endif  // ARTA_LINALG_DIRECT_HPP_
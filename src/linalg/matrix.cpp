@@ -1,29 +1,90 @@
 #include "matrix.hpp"
 
+#include <algorithm>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "../logger.hpp"
 #include "../print.hpp"
+#include "binary.hpp"
+#include "parallel.hpp"
 #include "vector.hpp"
 
-arta::linalg::Matrix::Matrix() : size_(0) {}
-arta::linalg::Matrix::Matrix(unsigned long n) : size_(n), row_ptr_(n + 1, 0) {}
-arta::linalg::Matrix::Matrix(unsigned long n, const double& v)
+namespace {
+template <typename _T, typename _I>
+void csr_multiply(unsigned long n, const _I* row_ptr, const _I* col_ind,
+                  const _T* vals, const _T* xv, _T* yv) {
+  arta::linalg::parallel_for(0, n, [=](unsigned long begin, unsigned long end) {
+    for (unsigned long r = begin; r < end; ++r) {
+      _T sum = 0.0;
+      for (_I k = row_ptr[r]; k < row_ptr[r + 1]; ++k) {
+        sum += vals[k] * xv[col_ind[k]];
+      }
+      yv[r] = sum;
+    }
+  });
+}
+
+template <typename _T, typename _I>
+arta::linalg::FileHeader mat_header(unsigned long size, unsigned long count) {
+  arta::linalg::FileHeader header = {};
+  std::memcpy(header.magic, "ARTAMAT", 8);
+  header.scalar_size = sizeof(_T);
+  header.index_size = sizeof(_I);
+  header.size = size;
+  header.count = count;
+  return header;
+}
+}  // namespace
+
+template <typename _T, typename _I>
+arta::linalg::BasicMatrix<_T, _I>::BasicMatrix() : size_(0) {}
+template <typename _T, typename _I>
+arta::linalg::BasicMatrix<_T, _I>::BasicMatrix(unsigned long n)
+    : size_(n), row_ptr_(n + 1, 0) {}
+template <typename _T, typename _I>
+arta::linalg::BasicMatrix<_T, _I>::BasicMatrix(unsigned long n, const _T& v)
     : size_(n), row_ptr_(n + 1, 0) {
   for (unsigned long i = 0; i < size_; ++i) {
     set(i, i, v);
   }
 }
-arta::linalg::Matrix::Matrix(const Matrix& copy)
+template <typename _T, typename _I>
+arta::linalg::BasicMatrix<_T, _I>::BasicMatrix(unsigned long n,
+                                               std::vector<_I> row_ptr,
+                                               std::vector<_I> col_ind,
+                                               std::vector<_T> vals)
+    : size_(n),
+      row_ptr_(std::move(row_ptr)),
+      col_ind_(std::move(col_ind)),
+      vals_(std::move(vals)) {}
+template <typename _T, typename _I>
+arta::linalg::BasicMatrix<_T, _I>::BasicMatrix(
+    const std::shared_ptr<const Pattern>& pattern)
+    : size_(pattern->size()),
+      row_ptr_(pattern->get_row_ptr()->begin(),
+               pattern->get_row_ptr()->end()),
+      col_ind_(pattern->get_col_ind()->begin(),
+               pattern->get_col_ind()->end()),
+      vals_(pattern->count(), 0.0),
+      pattern_(pattern) {}
+template <typename _T, typename _I>
+arta::linalg::BasicMatrix<_T, _I>::BasicMatrix(const BasicMatrix& copy)
     : size_(copy.size_),
       row_ptr_(copy.row_ptr_),
       col_ind_(copy.col_ind_),
-      vals_(copy.vals_) {}
-double& arta::linalg::Matrix::operator()(unsigned long r, unsigned long c) {
+      vals_(copy.vals_),
+      pattern_(copy.pattern_) {}
+template <typename _T, typename _I>
+_T& arta::linalg::BasicMatrix<_T, _I>::operator()(unsigned long r,
+                                                  unsigned long c) {
   if (row_ptr_[r + 1] - row_ptr_[r] == 0) {
+    pattern_.reset();
     vals_.insert(vals_.begin() + row_ptr_[r + 1], 0.0);
     col_ind_.insert(col_ind_.begin() + row_ptr_[r], c);
     for (unsigned long i = r + 1; i < size_ + 1; ++i) {
@@ -36,6 +97,7 @@ double& arta::linalg::Matrix::operator()(unsigned long r, unsigned long c) {
         return vals_[i];
       }
     }
+    pattern_.reset();
     vals_.insert(vals_.begin() + row_ptr_[r + 1], 0.0);
     col_ind_.insert(col_ind_.begin() + row_ptr_[r + 1], c);
     for (unsigned long i = r + 1; i < size_ + 1; ++i) {
@@ -44,8 +106,9 @@ double& arta::linalg::Matrix::operator()(unsigned long r, unsigned long c) {
     return vals_[row_ptr_[r + 1] - 1];
   }
 }
-double arta::linalg::Matrix::operator()(unsigned long r,
-                                        unsigned long c) const {
+template <typename _T, typename _I>
+_T arta::linalg::BasicMatrix<_T, _I>::operator()(unsigned long r,
+                                                 unsigned long c) const {
   if (row_ptr_[r + 1] - row_ptr_[r] == 0) {
     return 0.0;
   } else {
@@ -57,7 +120,9 @@ double arta::linalg::Matrix::operator()(unsigned long r,
     return 0.0;
   }
 }
-double arta::linalg::Matrix::at(unsigned long r, unsigned long c) const {
+template <typename _T, typename _I>
+_T arta::linalg::BasicMatrix<_T, _I>::at(unsigned long r,
+                                         unsigned long c) const {
   if (row_ptr_[r + 1] - row_ptr_[r] == 0) {
     return 0.0;
   } else {
@@ -69,10 +134,12 @@ double arta::linalg::Matrix::at(unsigned long r, unsigned long c) const {
     return 0.0;
   }
 }
-void arta::linalg::Matrix::set(unsigned long r, unsigned long c,
-                               const double& val) {
+template <typename _T, typename _I>
+void arta::linalg::BasicMatrix<_T, _I>::set(unsigned long r, unsigned long c,
+                                            const _T& val) {
   if (row_ptr_[r + 1] - row_ptr_[r] == 0) {
     if (val != 0) {
+      pattern_.reset();
       vals_.insert(vals_.begin() + row_ptr_[r + 1], val);
       col_ind_.insert(col_ind_.begin() + row_ptr_[r], c);
       for (unsigned long i = r + 1; i < size_ + 1; ++i) {
@@ -85,6 +152,7 @@ void arta::linalg::Matrix::set(unsigned long r, unsigned long c,
       if (col_ind_[i] == c) {
         vals_[i] = val;
         if (val == 0) {
+          pattern_.reset();
           vals_.erase(vals_.begin() + i);
           col_ind_.erase(col_ind_.begin() + i);
           for (unsigned long i = r + 1; i < size_ + 1; ++i) {
@@ -95,6 +163,7 @@ void arta::linalg::Matrix::set(unsigned long r, unsigned long c,
       }
     }
     if (val != 0) {
+      pattern_.reset();
       vals_.insert(vals_.begin() + row_ptr_[r + 1], val);
       col_ind_.insert(col_ind_.begin() + row_ptr_[r + 1], c);
       for (unsigned long i = r + 1; i < size_ + 1; ++i) {
@@ -104,17 +173,91 @@ void arta::linalg::Matrix::set(unsigned long r, unsigned long c,
     return;
   }
 }
-void arta::linalg::Matrix::clear() {
-  row_ptr_ = std::vector<unsigned long>(size_ + 1, 0);
+template <typename _T, typename _I>
+void arta::linalg::BasicMatrix<_T, _I>::clear() {
+  row_ptr_ = std::vector<_I>(size_ + 1, 0);
   col_ind_.clear();
   vals_.clear();
+  pattern_.reset();
+}
+
+template <typename _T, typename _I>
+void arta::linalg::BasicMatrix<_T, _I>::axpby(const _T& alpha,
+                                              const BasicMatrix& X,
+                                              const _T& beta,
+                                              const BasicMatrix& Y) {
+  if (X.size_ != Y.size_) {
+    log::warning("Matrix size mismatch %lu != %lu", X.size_, Y.size_);
+    return;
+  }
+  if (X.same_structure(Y)) {
+    if (!same_structure(X)) {
+      size_ = X.size_;
+      row_ptr_ = X.row_ptr_;
+      col_ind_ = X.col_ind_;
+      pattern_ = X.pattern_;
+      vals_.resize(X.vals_.size());
+    }
+    const _T* xv = X.vals_.data();
+    const _T* yv = Y.vals_.data();
+    _T* v = vals_.data();
+    for (unsigned long i = 0; i < vals_.size(); ++i) {
+      v[i] = alpha * xv[i] + beta * yv[i];
+    }
+    return;
+  }
+  std::vector<_I> row_ptr(X.size_ + 1, 0), col_ind;
+  std::vector<_T> vals;
+  col_ind.reserve(std::max(X.vals_.size(), Y.vals_.size()));
+  vals.reserve(col_ind.capacity());
+  // Two-way merge of each pair of rows, so the result stays sorted by
+  // column as ILU(0) and IC(0) expect.
+  for (unsigned long r = 0; r < X.size_; ++r) {
+    unsigned long kx = X.row_ptr_[r], ex = X.row_ptr_[r + 1];
+    unsigned long ky = Y.row_ptr_[r], ey = Y.row_ptr_[r + 1];
+    while (kx < ex || ky < ey) {
+      if (ky == ey || (kx < ex && X.col_ind_[kx] < Y.col_ind_[ky])) {
+        col_ind.push_back(X.col_ind_[kx]);
+        vals.push_back(alpha * X.vals_[kx++]);
+      } else if (kx == ex || Y.col_ind_[ky] < X.col_ind_[kx]) {
+        col_ind.push_back(Y.col_ind_[ky]);
+        vals.push_back(beta * Y.vals_[ky++]);
+      } else {
+        col_ind.push_back(X.col_ind_[kx]);
+        vals.push_back(alpha * X.vals_[kx++] + beta * Y.vals_[ky++]);
+      }
+    }
+    row_ptr[r + 1] = col_ind.size();
+  }
+  size_ = X.size_;
+  row_ptr_.swap(row_ptr);
+  col_ind_.swap(col_ind);
+  vals_.swap(vals);
+  pattern_.reset();
+}
+
+template <typename _T, typename _I>
+void arta::linalg::BasicMatrix<_T, _I>::apply(const BasicVector<_T>& x,
+                                              BasicVector<_T>& y) const {
+  multiply(*this, x, y);
+}
+
+template <typename _T, typename _I>
+bool arta::linalg::BasicMatrix<_T, _I>::same_structure(
+    const BasicMatrix& other) const {
+  if (this == &other || (pattern_ && pattern_ == other.pattern_)) {
+    return true;
+  }
+  return size_ == other.size_ && row_ptr_ == other.row_ptr_ &&
+         col_ind_ == other.col_ind_;
 }
 
-std::string arta::linalg::Matrix::dump() const {
+template <typename _T, typename _I>
+std::string arta::linalg::BasicMatrix<_T, _I>::dump() const {
   std::string str;
   for (int r = 0; r < size_; ++r) {
     for (int c = 0; c < size_; ++c) {
-      str += arta::fmt_val(at(r, c));
+      str += arta::fmt_val(static_cast<double>(at(r, c)));
       if (c < size_ - 1) {
         str += " ";
       }
@@ -126,102 +269,162 @@ std::string arta::linalg::Matrix::dump() const {
   return str;
 }
 
-arta::linalg::Matrix arta::linalg::operator+(const Matrix& lhs,
-                                             const Matrix& rhs) {
-  Matrix res(lhs);
-  for (unsigned long r = 0; r < res.size(); ++r) {
-    for (unsigned long c = 0; c < res.size(); ++c){
-      res.set(r, c, res.at(r, c) + rhs.at(r,c));
-    }
-  }
+template <typename _T, typename _I>
+arta::linalg::BasicMatrix<_T, _I> arta::linalg::operator+(
+    const BasicMatrix<_T, _I>& lhs, const BasicMatrix<_T, _I>& rhs) {
+  BasicMatrix<_T, _I> res;
+  res.axpby(1.0, lhs, 1.0, rhs);
   return res;
 }
-arta::linalg::Matrix arta::linalg::operator-(const Matrix& lhs,
-                                             const Matrix& rhs) {
-  Matrix res(lhs);
-  for (unsigned long r = 0; r < res.size(); ++r) {
-    for (unsigned long c = 0; c < res.size(); ++c){
-      res.set(r, c, res.at(r, c) - rhs.at(r,c));
-    }
-  }
+template <typename _T, typename _I>
+arta::linalg::BasicMatrix<_T, _I> arta::linalg::operator-(
+    const BasicMatrix<_T, _I>& lhs, const BasicMatrix<_T, _I>& rhs) {
+  BasicMatrix<_T, _I> res;
+  res.axpby(1.0, lhs, -1.0, rhs);
   return res;
 }
-arta::linalg::Matrix arta::linalg::operator*(const double& lhs,
-                                             const Matrix& rhs) {
-  Matrix res(rhs);
+template <typename _T, typename _I>
+arta::linalg::BasicMatrix<_T, _I> arta::linalg::operator*(
+    const typename BasicMatrix<_T, _I>::value_type& lhs,
+    const BasicMatrix<_T, _I>& rhs) {
+  BasicMatrix<_T, _I> res(rhs);
   for (unsigned long i = 0; i < res.count(); ++i) {
     res.get_vals()->at(i) *= lhs;
   }
   return res;
 }
 
-arta::linalg::Vector arta::linalg::operator*(const Matrix& lhs,
-                                             const Vector& rhs) {
-  Vector res(lhs.size());
-  for (unsigned long r = 0; r < lhs.size(); ++r) {
-    double sum = 0.0;
-    for (unsigned long c = 0; c < rhs.size() && c < lhs.size(); ++c) {
-      sum += (lhs.at(r, c) * rhs.at(c));
-    }
-    res.set(r, sum);
-  }
+template <typename _T, typename _I>
+arta::linalg::BasicVector<_T> arta::linalg::operator*(
+    const BasicMatrix<_T, _I>& lhs, const BasicVector<_T>& rhs) {
+  BasicVector<_T> res(lhs.size());
+  multiply(lhs, rhs, res);
   return res;
 }
 
+template <typename _T, typename _I>
+void arta::linalg::multiply(const BasicMatrix<_T, _I>& A,
+                            const BasicVector<_T>& x, BasicVector<_T>& y) {
+  if (y.size() != A.size()) {
+    y = BasicVector<_T>(A.size());
+  }
+  csr_multiply(A.size(), A.get_row_ptr()->data(), A.get_col_ind()->data(),
+               A.get_vals()->data(), x.get_vals()->data(),
+               y.get_vals()->data());
+}
+
+template <typename _T, typename _I>
+arta::linalg::BasicMatrixView<_T, _I>::BasicMatrixView()
+    : size_(0),
+      count_(0),
+      row_ptr_(nullptr),
+      col_ind_(nullptr),
+      vals_(nullptr) {}
+template <typename _T, typename _I>
+arta::linalg::BasicMatrixView<_T, _I>::BasicMatrixView(
+    const std::string& file_name)
+    : BasicMatrixView() {
+  std::shared_ptr<const MappedFile> file =
+      std::make_shared<const MappedFile>(file_name);
+  FileHeader header;
+  std::vector<unsigned long> offsets;
+  if (!read_header(*file, "ARTAMAT", sizeof(_T), sizeof(_I), &header) ||
+      !locate_arrays(*file, header,
+                     {(header.size + 1) * sizeof(_I),
+                      header.count * sizeof(_I), header.count * sizeof(_T)},
+                     &offsets)) {
+    log::warning("Failed to load matrix \"%s\"", file_name.c_str());
+    return;
+  }
+  file_ = file;
+  size_ = header.size;
+  count_ = header.count;
+  row_ptr_ = reinterpret_cast<const _I*>(file_->data() + offsets[0]);
+  col_ind_ = reinterpret_cast<const _I*>(file_->data() + offsets[1]);
+  vals_ = reinterpret_cast<const _T*>(file_->data() + offsets[2]);
+}
+
+template <typename _T, typename _I>
+void arta::linalg::BasicMatrixView<_T, _I>::apply(const BasicVector<_T>& x,
+                                                  BasicVector<_T>& y) const {
+  if (y.size() != size_) {
+    y = BasicVector<_T>(size_);
+  }
+  csr_multiply(size_, row_ptr_, col_ind_, vals_, x.get_vals()->data(),
+               y.get_vals()->data());
+}
+
+template <typename _T, typename _I>
 void arta::linalg::save_mat_to_file(const std::string& file_name,
-                                    const Matrix& mat) {
+                                    const BasicMatrix<_T, _I>& mat) {
+  write_binary(file_name, mat_header<_T, _I>(mat.size(), mat.count()),
+               {{mat.get_row_ptr()->data(), (mat.size() + 1) * sizeof(_I)},
+                {mat.get_col_ind()->data(), mat.count() * sizeof(_I)},
+                {mat.get_vals()->data(), mat.count() * sizeof(_T)}});
+}
+
+template <typename _T, typename _I>
+arta::linalg::BasicMatrix<_T, _I> arta::linalg::load_mat_from_file(
+    const std::string& file_name) {
+  BasicMatrixView<_T, _I> view(file_name);
+  if (!view.valid()) {
+    return BasicMatrix<_T, _I>();
+  }
+  return BasicMatrix<_T, _I>(
+      view.size(),
+      std::vector<_I>(view.row_ptr(), view.row_ptr() + view.size() + 1),
+      std::vector<_I>(view.col_ind(), view.col_ind() + view.count()),
+      std::vector<_T>(view.vals(), view.vals() + view.count()));
+}
+
+template <typename _T, typename _I>
+void arta::linalg::export_mat_to_text(const std::string& file_name,
+                                      const BasicMatrix<_T, _I>& mat) {
   FILE* out = fopen(file_name.c_str(), "w");
   if (!out) {
     log::warning("Failed to open file \"%s\"", file_name.c_str());
     return;
   }
   fprintf(out, "%lu %lu\n", mat.size(), mat.count());
-  const std::vector<unsigned long>* ulv = mat.get_row_ptr();
+  const std::vector<_I>* ulv = mat.get_row_ptr();
   for (unsigned long i = 0; i < ulv->size(); ++i) {
-    fprintf(out, "%lu ", ulv->at(i));
+    fprintf(out, "%lu ", static_cast<unsigned long>(ulv->at(i)));
   }
   fprintf(out, "\n");
   ulv = mat.get_col_ind();
   for (unsigned long i = 0; i < ulv->size(); ++i) {
-    fprintf(out, "%lu ", ulv->at(i));
+    fprintf(out, "%lu ", static_cast<unsigned long>(ulv->at(i)));
   }
   fprintf(out, "\n");
-  const std::vector<double>* dv = mat.get_vals();
+  const std::vector<_T>* dv = mat.get_vals();
   for (unsigned long i = 0; i < dv->size(); ++i) {
-    fprintf(out, "%0.10lf ", dv->at(i));
+    fprintf(out, "%0.10lf ", static_cast<double>(dv->at(i)));
   }
   fclose(out);
 }
 
-arta::linalg::Matrix arta::linalg::load_mat_from_file(
-    const std::string& file_name) {
-  FILE* src = fopen(file_name.c_str(), "r");
-  if (!src) {
-    log::warning("Failed to open file \"%s\"", file_name.c_str());
-    return Matrix();
-  }
-  unsigned long size, n_vals;
-  fscanf(src, "%lu %lu", &size, &n_vals);
-  Matrix mat(size);
-  std::vector<unsigned long>* row_ptr = mat.get_row_ptr();
-  std::vector<unsigned long>* col_ind = mat.get_col_ind();
-  std::vector<double>* vals = mat.get_vals();
-  row_ptr->clear();
-  for (unsigned long i = 0; i <= size; ++i) {
-    unsigned long rp;
-    fscanf(src, "%lu", &rp);
-    row_ptr->push_back(rp);
-  }
-  for (unsigned long i = 0; i < n_vals; ++i) {
-    unsigned long ci;
-    fscanf(src, "%lu", &ci);
-    col_ind->push_back(ci);
-  }
-  for (unsigned long i = 0; i < n_vals; ++i) {
-    double v;
-    fscanf(src, "%lf", &v);
-    vals->push_back(v);
-  }
-  fclose(src);
-  return mat;
-}
+#define ARTA_INSTANTIATE_MATRIX(_T, _I)                                       \
+  template class arta::linalg::BasicMatrix<_T, _I>;                           \
+  template class arta::linalg::BasicMatrixView<_T, _I>;                       \
+  template arta::linalg::BasicMatrix<_T, _I> arta::linalg::operator+(         \
+      const BasicMatrix<_T, _I>&, const BasicMatrix<_T, _I>&);                \
+  template arta::linalg::BasicMatrix<_T, _I> arta::linalg::operator-(         \
+      const BasicMatrix<_T, _I>&, const BasicMatrix<_T, _I>&);                \
+  template arta::linalg::BasicMatrix<_T, _I> arta::linalg::operator*(         \
+      const BasicMatrix<_T, _I>::value_type&, const BasicMatrix<_T, _I>&);    \
+  template arta::linalg::BasicVector<_T> arta::linalg::operator*(             \
+      const BasicMatrix<_T, _I>&, const BasicVector<_T>&);                    \
+  template void arta::linalg::multiply(const BasicMatrix<_T, _I>&,            \
+                                       const BasicVector<_T>&,                \
+                                       BasicVector<_T>&);                     \
+  template void arta::linalg::save_mat_to_file(const std::string&,            \
+                                               const BasicMatrix<_T, _I>&);   \
+  template arta::linalg::BasicMatrix<_T, _I>                                  \
+  arta::linalg::load_mat_from_file(const std::string&);                       \
+  template void arta::linalg::export_mat_to_text(const std::string&,          \
+                                                 const BasicMatrix<_T, _I>&);
+
+ARTA_INSTANTIATE_MATRIX(double, unsigned long)
+ARTA_INSTANTIATE_MATRIX(double, std::uint32_t)
+ARTA_INSTANTIATE_MATRIX(float, unsigned long)
+ARTA_INSTANTIATE_MATRIX(float, std::uint32_t)
@@ -1,53 +1,155 @@
 #ifndef ARTA_MATH_MATRIX_HPP_
 #define ARTA_MATH_MATRIX_HPP_
 
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
+#include "binary.hpp"
+#include "operator.hpp"
+#include "pattern.hpp"
 #include "vector.hpp"
 
 namespace arta {
 namespace linalg {
-  class Matrix {
+  // CSR matrix storing values as _T and row pointers/column indices as _I.
+  template <typename _T, typename _I>
+  class BasicMatrix final : public BasicOperator<_T> {
    public:
-    Matrix();
-    explicit Matrix(unsigned long n);
-    Matrix(unsigned long n, const double& v);
-    Matrix(const Matrix& mat);
+    typedef _T value_type;
+    typedef _I index_type;
 
-    inline unsigned long size() const noexcept { return size_; }
+    BasicMatrix();
+    explicit BasicMatrix(unsigned long n);
+    BasicMatrix(unsigned long n, const _T& v);
+    BasicMatrix(unsigned long n, std::vector<_I> row_ptr,
+                std::vector<_I> col_ind, std::vector<_T> vals);
+    explicit BasicMatrix(const std::shared_ptr<const Pattern>& pattern);
+    BasicMatrix(const BasicMatrix& mat);
+    BasicMatrix(BasicMatrix&& mat) noexcept = default;
+    template <typename _U, typename _J>
+    explicit BasicMatrix(const BasicMatrix<_U, _J>& mat)
+        : size_(mat.size()),
+          row_ptr_(mat.get_row_ptr()->begin(), mat.get_row_ptr()->end()),
+          col_ind_(mat.get_col_ind()->begin(), mat.get_col_ind()->end()),
+          vals_(mat.get_vals()->begin(), mat.get_vals()->end()),
+          pattern_(mat.pattern()) {}
+
+    BasicMatrix& operator=(const BasicMatrix& mat) = default;
+    BasicMatrix& operator=(BasicMatrix&& mat) noexcept = default;
+
+    inline unsigned long size() const noexcept override { return size_; }
     inline unsigned long count() const noexcept { return vals_.size(); }
 
-    double& operator()(unsigned long r, unsigned long c);
-    double operator()(unsigned long r, unsigned long c) const;
-    double at(unsigned long r, unsigned long c) const;
-    void set(unsigned long r, unsigned long c, const double& val);
+    void apply(const BasicVector<_T>& x, BasicVector<_T>& y) const override;
+
+    _T& operator()(unsigned long r, unsigned long c);
+    _T operator()(unsigned long r, unsigned long c) const;
+    _T at(unsigned long r, unsigned long c) const;
+    void set(unsigned long r, unsigned long c, const _T& val);
 
     void clear();
 
+    // Sets this matrix to alpha * X + beta * Y. When X, Y and this matrix
+    // share a structure only the values are written, with no allocation;
+    // otherwise the row patterns of X and Y are merged in O(nnz). The
+    // merge expects the rows of X and Y sorted by column, as pattern built
+    // matrices are, and keeps them sorted.
+    void axpby(const _T& alpha, const BasicMatrix& X, const _T& beta,
+               const BasicMatrix& Y);
+    bool same_structure(const BasicMatrix& other) const;
+
     std::string dump() const;
 
-    std::vector<unsigned long>* get_row_ptr() { return &row_ptr_; }
-    std::vector<unsigned long>* get_col_ind() { return &col_ind_; }
-    std::vector<double>* get_vals() { return &vals_; }
-    const std::vector<unsigned long>* get_row_ptr() const { return &row_ptr_; }
-    const std::vector<unsigned long>* get_col_ind() const { return &col_ind_; }
-    const std::vector<double>* get_vals() const { return &vals_; }
+    // Matrices built from a pattern keep a reference to it for as long as
+    // their structure is unchanged, so callers can detect a shared layout.
+    std::shared_ptr<const Pattern> pattern() const { return pattern_; }
+
+    std::vector<_I>* get_row_ptr() {
+      pattern_.reset();
+      return &row_ptr_;
+    }
+    std::vector<_I>* get_col_ind() {
+      pattern_.reset();
+      return &col_ind_;
+    }
+    std::vector<_T>* get_vals() { return &vals_; }
+    const std::vector<_I>* get_row_ptr() const { return &row_ptr_; }
+    const std::vector<_I>* get_col_ind() const { return &col_ind_; }
+    const std::vector<_T>* get_vals() const { return &vals_; }
 
    private:
     unsigned long size_;
-    std::vector<unsigned long> row_ptr_, col_ind_;
-    std::vector<double> vals_;
+    std::vector<_I> row_ptr_, col_ind_;
+    std::vector<_T> vals_;
+    std::shared_ptr<const Pattern> pattern_;
+  };
+
+  // Read-only CSR matrix used in place from a memory mapped .mat file.
+  template <typename _T, typename _I>
+  class BasicMatrixView final : public BasicOperator<_T> {
+   public:
+    typedef _T value_type;
+    typedef _I index_type;
+
+    BasicMatrixView();
+    explicit BasicMatrixView(const std::string& file_name);
+
+    inline bool valid() const noexcept { return file_ != nullptr; }
+    inline unsigned long size() const noexcept override { return size_; }
+    inline unsigned long count() const noexcept { return count_; }
+
+    void apply(const BasicVector<_T>& x, BasicVector<_T>& y) const override;
+
+    inline const _I* row_ptr() const noexcept { return row_ptr_; }
+    inline const _I* col_ind() const noexcept { return col_ind_; }
+    inline const _T* vals() const noexcept { return vals_; }
+
+   private:
+    std::shared_ptr<const MappedFile> file_;
+    unsigned long size_, count_;
+    const _I* row_ptr_;
+    const _I* col_ind_;
+    const _T* vals_;
   };
 
-  Matrix operator+(const Matrix& lhs, const Matrix& rhs);
-  Matrix operator-(const Matrix& lhs, const Matrix& rhs);
+  typedef BasicMatrix<double, unsigned long> Matrix;
+  typedef BasicMatrix<double, std::uint32_t> Matrix32;
+  typedef BasicMatrix<float, std::uint32_t> Matrixf;
+  typedef BasicMatrixView<double, unsigned long> MatrixView;
+
+  template <typename _T, typename _I>
+  BasicMatrix<_T, _I> operator+(const BasicMatrix<_T, _I>& lhs,
+                                const BasicMatrix<_T, _I>& rhs);
+  template <typename _T, typename _I>
+  BasicMatrix<_T, _I> operator-(const BasicMatrix<_T, _I>& lhs,
+                                const BasicMatrix<_T, _I>& rhs);
+
+  template <typename _T, typename _I>
+  BasicMatrix<_T, _I> operator*(
+      const typename BasicMatrix<_T, _I>::value_type& lhs,
+      const BasicMatrix<_T, _I>& rhs);
+  template <typename _T, typename _I>
+  BasicVector<_T> operator*(const BasicMatrix<_T, _I>& lhs,
+                            const BasicVector<_T>& rhs);
 
-  Matrix operator*(const double& lhs, const Matrix& rhs);
-  Vector operator*(const Matrix& lhs, const Vector& rhs);
+  // Row-partitioned CSR product y = A x, split across the linalg thread
+  // pool. y is resized to A.size() if needed.
+  template <typename _T, typename _I>
+  void multiply(const BasicMatrix<_T, _I>& A, const BasicVector<_T>& x,
+                BasicVector<_T>& y);
 
-  void save_mat_to_file(const std::string& file_name, const Matrix& mat);
-  Matrix load_mat_from_file(const std::string& file_name);
+  // Binary .mat files, see binary.hpp. Loading maps the file and copies the
+  // arrays out in bulk; use BasicMatrixView to work on them in place.
+  template <typename _T, typename _I>
+  void save_mat_to_file(const std::string& file_name,
+                        const BasicMatrix<_T, _I>& mat);
+  template <typename _T = double, typename _I = unsigned long>
+  BasicMatrix<_T, _I> load_mat_from_file(const std::string& file_name);
+  template <typename _T, typename _I>
+  void export_mat_to_text(const std::string& file_name,
+                          const BasicMatrix<_T, _I>& mat);
 }  // namespace linalg
 }  // namespace arta
 
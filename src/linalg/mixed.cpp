@@ -0,0 +1,149 @@
+#include "mixed.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+
+#include "../logger.hpp"
+#include "blas.hpp"
+#include "direct.hpp"
+#include "matrix.hpp"
+#include "precond.hpp"
+#include "solver.hpp"
+#include "vector.hpp"
+#include "workspace.hpp"
+
+void arta::linalg::MixedPrecision::Widened::apply(const Vectorf& x,
+                                                  Vectorf& y) const {
+  std::copy(x.get_vals()->begin(), x.get_vals()->end(),
+            x_.get_vals()->begin());
+  M->apply(x_, y_);
+  std::copy(y_.get_vals()->begin(), y_.get_vals()->end(),
+            y.get_vals()->begin());
+}
+
+arta::linalg::MixedPrecision::MixedPrecision(
+    const SolverOptions& opts, std::unique_ptr<Preconditioner> precond)
+    : opts_(opts), precond_(std::move(precond)), direct_(true) {
+  const std::string& method = opts_.method;
+  if (method != "gmres" && method != "bicgstab" && method != "cg" &&
+      method != "direct") {
+    if (method != "") {
+      log::warning("No single precision %s, refining with gmres",
+                   method.c_str());
+    }
+    opts_.method = "gmres";
+  }
+  opts_.rtol = ARTA_MIXED_INNER_TOL;
+  opts_.atol = 0.0;
+  opts_.history = false;
+  opts_.guess = false;
+  opts_.mixed = false;
+}
+
+void arta::linalg::MixedPrecision::setup(const Matrix& A) {
+  size_ = A.size();
+  if (opts_.method == "direct") {
+    direct_.setup(A);
+    return;
+  }
+  A_ = Matrixf(A);
+  if (precond_) {
+    precond_->setup(A);
+    widened_.M = precond_.get();
+    widened_.x_ = Vector(size_);
+    widened_.y_ = Vector(size_);
+  }
+  r_ = Vectorf(size_);
+  e_ = Vectorf(size_);
+  ws_.resize(size_);
+}
+
+void arta::linalg::MixedPrecision::apply(const Vector& r, Vector& e) const {
+  solve(r, e, ARTA_MIXED_INNER_TOL);
+}
+
+void arta::linalg::MixedPrecision::solve(const Vector& r, Vector& e,
+                                         const double& rtol) const {
+  if (opts_.method == "direct") {
+    direct_.apply(r, e);
+    iterations_ = 1;
+    return;
+  }
+  // Scaling r to unit norm keeps small residuals clear of the float
+  // range.
+  double scale = nrm2(r);
+  if (scale == 0.0) {
+    std::fill(e.get_vals()->begin(), e.get_vals()->end(), 0.0);
+    iterations_ = 0;
+    return;
+  }
+  const double* rv = r.get_vals()->data();
+  float* rf = r_.get_vals()->data();
+  for (unsigned long i = 0; i < size_; ++i) {
+    rf[i] = static_cast<float>(rv[i] / scale);
+  }
+  ws_.reset();
+  opts_.rtol = rtol;
+  const Operatorf* M = precond_ ? &widened_ : nullptr;
+  SolverResult result;
+  if (opts_.method == "cg") {
+    result = conjugate_gradient(A_, r_, e_, ws_, opts_, M);
+  } else if (opts_.method == "bicgstab") {
+    result = bicgstab(A_, r_, e_, ws_, opts_, M);
+  } else {
+    result = gmres(A_, r_, e_, ws_, opts_, M);
+  }
+  iterations_ = result.iterations;
+  const float* ef = e_.get_vals()->data();
+  double* ev = e.get_vals()->data();
+  for (unsigned long i = 0; i < size_; ++i) {
+    ev[i] = scale * ef[i];
+  }
+}
+
+arta::linalg::SolverResult arta::linalg::mixed_solve(
+    const Matrix& A, const Vector& b, Vector& x, Workspace& ws,
+    const MixedPrecision& M, const SolverOptions& opts) {
+  ws.resize(b.size());
+  if (x.size() != b.size()) {
+    x = Vector(b.size());
+  } else if (!opts.guess) {
+    std::fill(x.get_vals()->begin(), x.get_vals()->end(), 0.0);
+  }
+  Vector& r = ws.acquire();
+  Vector& e = ws.acquire();
+  SolverResult result;
+  result.start(nrm2(b), opts);
+  unsigned it = 0;
+  double last = 0.0;
+  while (true) {
+    multiply(A, x, r);
+    axpby(1.0, b, -1.0, r);
+    double res = nrm2(r);
+    if (it != 0 && !(res < last)) {
+      // The single precision system is too far from A for its corrections
+      // to help any further.
+      log::warning("Mixed precision refinement stalled at residual %e, "
+                   "finishing in double",
+                   res);
+      SolverOptions rest = opts;
+      rest.mixed = false;
+      rest.guess = std::isfinite(res);
+      SolverResult tail =
+          arta::linalg::solve(A, b, x, ws, rest, M.preconditioner());
+      result.update(it + tail.iterations, tail.residual);
+      break;
+    }
+    if (result.update(it, res) || it >= opts.max_iters) break;
+    last = res;
+    // Asks for twice the remaining reduction, so the last step does not
+    // fall just short of the tolerance.
+    M.solve(r, e,
+            std::max(ARTA_MIXED_INNER_TOL, 0.5 * result.tolerance / res));
+    axpy(1.0, e, x);
+    it += std::max(M.iterations(), 1u);
+  }
+  return result;
+}
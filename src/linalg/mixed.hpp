@@ -0,0 +1,86 @@
+#ifndef ARTA_LINALG_MIXED_HPP_
+#define ARTA_LINALG_MIXED_HPP_
+
+#include <memory>
+#include <string>
+
+#include "direct.hpp"
+#include "matrix.hpp"
+#include "operator.hpp"
+#include "precond.hpp"
+#include "solver.hpp"
+#include "vector.hpp"
+#include "workspace.hpp"
+
+// Residual reduction of the single precision inner solves, well above the
+// roughly 1e-7 that float arithmetic can reach.
+#define ARTA_MIXED_INNER_TOL 1e-4
+
+namespace arta {
+namespace linalg {
+  // Single precision correction solve for iterative refinement. setup()
+  // rounds A to a Matrixf, float values and 32 bit indices, which halves
+  // the bytes every product streams. apply(r, e) then solves A e = r in
+  // float with the inner method to ARTA_MIXED_INNER_TOL. The
+  // preconditioner, if any, stays in double. The inner method "direct"
+  // instead keeps single precision factors (see Direct).
+  class MixedPrecision final : public Preconditioner {
+   public:
+    // The inner method is opts.method, "gmres", "bicgstab", "cg" or
+    // "direct"; other methods are reported and replaced by gmres, with
+    // precond as its preconditioner. precond is set up along with A and
+    // ignored by "direct".
+    explicit MixedPrecision(
+        const SolverOptions& opts,
+        std::unique_ptr<Preconditioner> precond = nullptr);
+
+    void setup(const Matrix& A) override;
+    // Not safe to call concurrently, the solves share their vectors.
+    void apply(const Vector& r, Vector& e) const override;
+    // apply() with the inner solve stopping once its residual is below
+    // rtol ||r||.
+    void solve(const Vector& r, Vector& e, const double& rtol) const;
+
+    // Inner iterations of the last solve, 1 for a direct solve.
+    inline unsigned iterations() const noexcept { return iterations_; }
+    inline const Preconditioner* preconditioner() const noexcept {
+      return precond_.get();
+    }
+
+   private:
+    // The double precision preconditioner applied to float vectors.
+    class Widened final : public Operatorf {
+     public:
+      inline unsigned long size() const noexcept override {
+        return M->size();
+      }
+      void apply(const Vectorf& x, Vectorf& y) const override;
+
+      const Preconditioner* M = nullptr;
+      mutable Vector x_, y_;
+    };
+
+    // The inner solve, its method and restart from the options given.
+    mutable SolverOptions opts_;
+    std::unique_ptr<Preconditioner> precond_;
+    Direct direct_;
+    Matrixf A_;
+    Widened widened_;
+    mutable Vectorf r_, e_;
+    mutable Workspacef ws_;
+    mutable unsigned iterations_ = 0;
+  };
+
+  // Iterative refinement: x += M^-1 (b - A x), the residual and update in
+  // double and the corrections in single precision, until the residual
+  // meets opts. The last inner solve only reduces the residual as far as
+  // opts needs. Should the corrections stop reducing the residual, the
+  // solve is finished in double with M's preconditioner. The result counts
+  // the inner iterations.
+  SolverResult mixed_solve(const Matrix& A, const Vector& b, Vector& x,
+                           Workspace& ws, const MixedPrecision& M,
+                           const SolverOptions& opts = SolverOptions());
+}  // namespace linalg
+}  // namespace arta
+
+#endif  // ARTA_LINALG_MIXED_HPP_
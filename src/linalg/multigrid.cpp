@@ -0,0 +1,425 @@
+#include "multigrid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "../logger.hpp"
+#include "blas.hpp"
+#include "coloring.hpp"
+#include "matrix.hpp"
+#include "sparse.hpp"
+#include "vector.hpp"
+#include "workspace.hpp"
+
+namespace {
+// Aggregate of every unknown, -1 for unknowns without strong connections,
+// which are left to the smoother. Returns the number of aggregates.
+long aggregate(const arta::linalg::Matrix& A, const std::vector<double>& diag,
+               std::vector<long>& agg) {
+  const std::vector<unsigned long>& row_ptr = *A.get_row_ptr();
+  const std::vector<unsigned long>& col_ind = *A.get_col_ind();
+  const std::vector<double>& vals = *A.get_vals();
+  unsigned long n = A.size();
+  std::vector<unsigned long> s_ptr(n + 1, 0), s_ind;
+  s_ind.reserve(col_ind.size());
+  for (unsigned long i = 0; i < n; ++i) {
+    for (unsigned long k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+      unsigned long j = col_ind[k];
+      if (j != i && std::fabs(vals[k]) >=
+                        ARTA_AMG_THETA *
+                            std::sqrt(std::fabs(diag[i] * diag[j]))) {
+        s_ind.push_back(j);
+      }
+    }
+    s_ptr[i + 1] = s_ind.size();
+  }
+  const long unassigned = -2;
+  agg.assign(n, unassigned);
+  for (unsigned long i = 0; i < n; ++i) {
+    if (s_ptr[i] == s_ptr[i + 1]) {
+      agg[i] = -1;
+    }
+  }
+  long count = 0;
+  // Unknowns whose strong neighbourhood is still free seed an aggregate
+  // covering all of it.
+  for (unsigned long i = 0; i < n; ++i) {
+    if (agg[i] != unassigned) continue;
+    bool free = true;
+    for (unsigned long k = s_ptr[i]; k < s_ptr[i + 1] && free; ++k) {
+      free = agg[s_ind[k]] == unassigned || agg[s_ind[k]] == -1;
+    }
+    if (!free) continue;
+    agg[i] = count;
+    for (unsigned long k = s_ptr[i]; k < s_ptr[i + 1]; ++k) {
+      if (agg[s_ind[k]] == unassigned) {
+        agg[s_ind[k]] = count;
+      }
+    }
+    count++;
+  }
+  // The rest join a neighbouring aggregate from the first pass, marked by
+  // -3 - aggregate until the pass ends so they do not chain.
+  for (unsigned long i = 0; i < n; ++i) {
+    if (agg[i] != unassigned) continue;
+    for (unsigned long k = s_ptr[i]; k < s_ptr[i + 1]; ++k) {
+      if (agg[s_ind[k]] >= 0) {
+        agg[i] = -3 - agg[s_ind[k]];
+        break;
+      }
+    }
+  }
+  for (unsigned long i = 0; i < n; ++i) {
+    if (agg[i] <= -3) {
+      agg[i] = -3 - agg[i];
+    }
+  }
+  // Anything still left forms new aggregates with its free neighbours.
+  for (unsigned long i = 0; i < n; ++i) {
+    if (agg[i] != unassigned) continue;
+    agg[i] = count;
+    for (unsigned long k = s_ptr[i]; k < s_ptr[i + 1]; ++k) {
+      if (agg[s_ind[k]] == unassigned) {
+        agg[s_ind[k]] = count;
+      }
+    }
+    count++;
+  }
+  return count;
+}
+
+// Estimate of rho(D^-1 A) by power iteration, from a fixed start so the
+// hierarchy is reproducible.
+double spectral_radius(const arta::linalg::Matrix& A,
+                       const std::vector<double>& dinv) {
+  unsigned long n = A.size();
+  arta::linalg::Vector v(n), w(n);
+  for (unsigned long i = 0; i < n; ++i) {
+    v[i] = 1.0 + static_cast<double>((i * 7919) % 101) / 101.0;
+  }
+  double rho = 0.0;
+  for (unsigned it = 0; it < ARTA_AMG_POWER_ITERS; ++it) {
+    arta::linalg::scal(1.0 / arta::linalg::nrm2(v), v);
+    arta::linalg::multiply(A, v, w);
+    for (unsigned long i = 0; i < n; ++i) {
+      w[i] *= dinv[i];
+    }
+    rho = arta::linalg::nrm2(w);
+    std::swap(v, w);
+  }
+  return rho;
+}
+
+// P = (I - omega D^-1 A) T for the piecewise constant tentative prolongator
+// T of agg, with omega = 4 / (3 rho(D^-1 A)).
+arta::linalg::SparseMatrix prolongator(const arta::linalg::Matrix& A,
+                                       const std::vector<double>& dinv,
+                                       const std::vector<long>& agg,
+                                       long count) {
+  unsigned long n = A.size();
+  std::vector<unsigned long> size(count, 0);
+  for (unsigned long i = 0; i < n; ++i) {
+    if (agg[i] >= 0) size[agg[i]]++;
+  }
+  arta::linalg::SparseMatrix T(n, count);
+  for (unsigned long i = 0; i < n; ++i) {
+    if (agg[i] >= 0) {
+      T.col_ind.push_back(agg[i]);
+      T.vals.push_back(1.0 / std::sqrt(static_cast<double>(size[agg[i]])));
+    }
+    T.row_ptr[i + 1] = T.col_ind.size();
+  }
+  double rho = spectral_radius(A, dinv);
+  double omega = rho > 0.0 ? 4.0 / (3.0 * rho) : 0.0;
+  arta::linalg::SparseMatrix AT =
+      arta::linalg::spgemm(arta::linalg::SparseMatrix(A), T);
+  arta::linalg::SparseMatrix P(n, count);
+  P.col_ind.reserve(AT.count() + n);
+  P.vals.reserve(AT.count() + n);
+  for (unsigned long i = 0; i < n; ++i) {
+    bool placed = T.row_ptr[i] == T.row_ptr[i + 1];
+    for (unsigned long k = AT.row_ptr[i]; k < AT.row_ptr[i + 1]; ++k) {
+      double val = -omega * dinv[i] * AT.vals[k];
+      if (!placed && AT.col_ind[k] >= T.col_ind[T.row_ptr[i]]) {
+        if (AT.col_ind[k] == T.col_ind[T.row_ptr[i]]) {
+          val += T.vals[T.row_ptr[i]];
+        } else {
+          P.col_ind.push_back(T.col_ind[T.row_ptr[i]]);
+          P.vals.push_back(T.vals[T.row_ptr[i]]);
+        }
+        placed = true;
+      }
+      P.col_ind.push_back(AT.col_ind[k]);
+      P.vals.push_back(val);
+    }
+    if (!placed) {
+      P.col_ind.push_back(T.col_ind[T.row_ptr[i]]);
+      P.vals.push_back(T.vals[T.row_ptr[i]]);
+    }
+    P.row_ptr[i + 1] = P.col_ind.size();
+  }
+  return P;
+}
+}  // namespace
+
+arta::linalg::Multigrid::Multigrid(const std::string& smoother,
+                                   unsigned sweeps, unsigned cycle)
+    : jacobi_(smoother == "jacobi"),
+      colored_(smoother == "mcgs"),
+      sweeps_(std::max(sweeps, 1u)),
+      cycle_(std::max(cycle, 1u)) {
+  if (smoother != "gs" && smoother != "mcgs" && smoother != "jacobi") {
+    log::warning("Unknown multigrid smoother \"%s\", using gs",
+                 smoother.c_str());
+  }
+}
+
+void arta::linalg::Multigrid::reset(const Matrix& A) {
+  size_ = A.size();
+  levels_.clear();
+  levels_.emplace_back();
+  levels_.back().A = A;
+  init_level(levels_.back());
+}
+
+void arta::linalg::Multigrid::init_level(Level& level) {
+  const std::vector<unsigned long>& row_ptr = *level.A.get_row_ptr();
+  const std::vector<unsigned long>& col_ind = *level.A.get_col_ind();
+  const std::vector<double>& vals = *level.A.get_vals();
+  unsigned long n = level.A.size();
+  level.dinv.assign(n, 0.0);
+  for (unsigned long i = 0; i < n; ++i) {
+    for (unsigned long k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+      if (col_ind[k] == i && vals[k] != 0.0) {
+        level.dinv[i] = 1.0 / vals[k];
+      }
+    }
+  }
+  if (colored_) {
+    level.colors = Coloring(level.A);
+  }
+  level.b = Vector(n);
+  level.x = Vector(n);
+  level.r = Vector(n);
+}
+
+void arta::linalg::Multigrid::add_level(SparseMatrix&& P) {
+  Level& level = levels_.back();
+  level.P = std::move(P);
+  level.R = transpose(level.P);
+  Matrix coarse = galerkin(level.P, level.R, level.A);
+  levels_.emplace_back();
+  levels_.back().A = std::move(coarse);
+  init_level(levels_.back());
+}
+
+bool arta::linalg::Multigrid::coarsen() {
+  const Level& level = levels_.back();
+  unsigned long n = level.A.size();
+  std::vector<double> diag(n, 0.0);
+  for (unsigned long i = 0; i < n; ++i) {
+    if (level.dinv[i] != 0.0) diag[i] = 1.0 / level.dinv[i];
+  }
+  std::vector<long> agg;
+  long count = aggregate(level.A, diag, agg);
+  // Stop once coarsening stalls, the last level is then solved directly.
+  if (count == 0 || static_cast<unsigned long>(count) * 10 > n * 9) {
+    return false;
+  }
+  add_level(prolongator(level.A, level.dinv, agg, count));
+  return true;
+}
+
+void arta::linalg::Multigrid::finish() {
+  // Dense LU of the coarsest level.
+  const Matrix& C = levels_.back().A;
+  unsigned long n = C.size();
+  if (n > 4 * ARTA_MG_COARSE) {
+    log::warning("Multigrid coarsening stalled at %lu unknowns", n);
+  }
+  lu_.assign(n * n, 0.0);
+  piv_.resize(n);
+  for (unsigned long i = 0; i < n; ++i) {
+    for (unsigned long k = (*C.get_row_ptr())[i]; k < (*C.get_row_ptr())[i + 1];
+         ++k) {
+      lu_[i * n + (*C.get_col_ind())[k]] = (*C.get_vals())[k];
+    }
+  }
+  for (unsigned long c = 0; c < n; ++c) {
+    unsigned long p = c;
+    for (unsigned long r = c + 1; r < n; ++r) {
+      if (std::fabs(lu_[r * n + c]) > std::fabs(lu_[p * n + c])) p = r;
+    }
+    piv_[c] = p;
+    if (p != c) {
+      std::swap_ranges(lu_.begin() + c * n, lu_.begin() + (c + 1) * n,
+                       lu_.begin() + p * n);
+    }
+    if (lu_[c * n + c] == 0.0) {
+      // Singular coarse operator, e.g. a pure Neumann problem.
+      lu_[c * n + c] = 1.0;
+    }
+    for (unsigned long r = c + 1; r < n; ++r) {
+      double l = lu_[r * n + c] /= lu_[c * n + c];
+      if (l == 0.0) continue;
+      for (unsigned long k = c + 1; k < n; ++k) {
+        lu_[r * n + k] -= l * lu_[c * n + k];
+      }
+    }
+  }
+}
+
+unsigned long arta::linalg::Multigrid::level_size(unsigned l) const {
+  return l < levels_.size() ? levels_[l].A.size() : 0;
+}
+double arta::linalg::Multigrid::complexity() const {
+  if (levels_.empty() || levels_[0].A.count() == 0) return 0.0;
+  double count = 0.0;
+  for (const Level& level : levels_) {
+    count += level.A.count();
+  }
+  return count / levels_[0].A.count();
+}
+
+void arta::linalg::Multigrid::apply(const Vector& x, Vector& y) const {
+  cycle(0, x, y, true);
+}
+
+void arta::linalg::Multigrid::cycle(unsigned l, const Vector& b, Vector& x,
+                                    bool zero) const {
+  const Level& level = levels_[l];
+  if (l + 1 == levels_.size()) {
+    unsigned long n = level.A.size();
+    double* xv = x.get_vals()->data();
+    std::copy(b.get_vals()->begin(), b.get_vals()->end(), xv);
+    for (unsigned long c = 0; c < n; ++c) {
+      std::swap(xv[c], xv[piv_[c]]);
+      for (unsigned long r = c + 1; r < n; ++r) {
+        xv[r] -= lu_[r * n + c] * xv[c];
+      }
+    }
+    for (unsigned long r = n; r-- > 0;) {
+      for (unsigned long k = r + 1; k < n; ++k) {
+        xv[r] -= lu_[r * n + k] * xv[k];
+      }
+      xv[r] /= lu_[r * n + r];
+    }
+    return;
+  }
+  const Level& next = levels_[l + 1];
+  if (zero) {
+    std::fill(x.get_vals()->begin(), x.get_vals()->end(), 0.0);
+  }
+  smooth(level, b, x, false);
+  multiply(level.A, x, level.r);
+  axpby(1.0, b, -1.0, level.r);
+  multiply(level.R, level.r, next.b);
+  // A W-cycle visits the coarse level again from its first correction, the
+  // coarsest level is solved exactly and needs only one visit.
+  unsigned visits = l + 2 == levels_.size() ? 1 : cycle_;
+  for (unsigned v = 0; v < visits; ++v) {
+    cycle(l + 1, next.b, next.x, v == 0);
+  }
+  multiply(level.P, next.x, level.r);
+  axpy(1.0, level.r, x);
+  smooth(level, b, x, true);
+}
+
+void arta::linalg::Multigrid::smooth(const Level& level, const Vector& b,
+                                     Vector& x, bool backward) const {
+  const double* dinv = level.dinv.data();
+  const double* bv = b.get_vals()->data();
+  double* xv = x.get_vals()->data();
+  unsigned long n = level.A.size();
+  if (jacobi_) {
+    double* rv = level.r.get_vals()->data();
+    for (unsigned s = 0; s < sweeps_; ++s) {
+      multiply(level.A, x, level.r);
+      for (unsigned long i = 0; i < n; ++i) {
+        xv[i] += 2.0 / 3.0 * dinv[i] * (bv[i] - rv[i]);
+      }
+    }
+    return;
+  }
+  if (colored_) {
+    for (unsigned s = 0; s < sweeps_; ++s) {
+      multicolor_sweep(level.A, b, x, level.colors, dinv, 1.0, backward);
+    }
+    return;
+  }
+  const unsigned long* row_ptr = level.A.get_row_ptr()->data();
+  const unsigned long* col_ind = level.A.get_col_ind()->data();
+  const double* vals = level.A.get_vals()->data();
+  for (unsigned s = 0; s < sweeps_; ++s) {
+    for (unsigned long j = 0; j < n; ++j) {
+      unsigned long i = backward ? n - 1 - j : j;
+      double sum = bv[i];
+      for (unsigned long k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+        sum -= vals[k] * xv[col_ind[k]];
+      }
+      xv[i] += sum * dinv[i];
+    }
+  }
+}
+
+arta::linalg::AMG::AMG(const std::string& smoother, unsigned sweeps,
+                       unsigned cycle)
+    : Multigrid(smoother, sweeps, cycle) {}
+
+void arta::linalg::AMG::setup(const Matrix& A) {
+  reset(A);
+  while (coarsest_size() > ARTA_MG_COARSE && levels() < ARTA_MG_MAX_LEVELS &&
+         coarsen()) {
+  }
+  finish();
+}
+
+arta::linalg::GMG::GMG(std::vector<SparseMatrix> prolongators,
+                       const std::string& smoother, unsigned sweeps,
+                       unsigned cycle)
+    : Multigrid(smoother, sweeps, cycle),
+      prolongators_(std::move(prolongators)) {}
+
+void arta::linalg::GMG::setup(const Matrix& A) {
+  reset(A);
+  for (const SparseMatrix& P : prolongators_) {
+    if (levels() == ARTA_MG_MAX_LEVELS) break;
+    if (P.rows != coarsest_size()) {
+      log::warning("Prolongator of %lu rows does not match level of %lu",
+                   P.rows, coarsest_size());
+      break;
+    }
+    add_level(SparseMatrix(P));
+  }
+  while (coarsest_size() > ARTA_MG_COARSE && levels() < ARTA_MG_MAX_LEVELS &&
+         coarsen()) {
+  }
+  finish();
+}
+
+arta::linalg::SolverResult arta::linalg::mg_solve(const Matrix& A,
+                                                  const Vector& b, Vector& x,
+                                                  Workspace& ws,
+                                                  const Multigrid& M,
+                                                  const SolverOptions& opts) {
+  ws.resize(b.size());
+  if (x.size() != b.size()) {
+    x = Vector(b.size());
+  } else if (!opts.guess) {
+    std::fill(x.get_vals()->begin(), x.get_vals()->end(), 0.0);
+  }
+  Vector& r = ws.acquire();
+  Vector& e = ws.acquire();
+  SolverResult result;
+  result.start(nrm2(b), opts);
+  for (unsigned i = 0;; ++i) {
+    multiply(A, x, r);
+    axpby(1.0, b, -1.0, r);
+    if (result.update(i, nrm2(r)) || i == opts.max_iters) break;
+    M.apply(r, e);
+    axpy(1.0, e, x);
+  }
+  return result;
+}
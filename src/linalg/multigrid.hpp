@@ -0,0 +1,121 @@
+#ifndef ARTA_LINALG_MULTIGRID_HPP_
+#define ARTA_LINALG_MULTIGRID_HPP_
+
+#include <string>
+#include <vector>
+
+#include "coloring.hpp"
+#include "matrix.hpp"
+#include "precond.hpp"
+#include "solver.hpp"
+#include "sparse.hpp"
+#include "vector.hpp"
+#include "workspace.hpp"
+
+// Levels are added until one has at most this many unknowns, which is then
+// solved directly.
+#define ARTA_MG_COARSE 200
+#define ARTA_MG_MAX_LEVELS 12
+// Entries with |a_ij| >= theta sqrt(|a_ii a_jj|) are strong connections.
+#define ARTA_AMG_THETA 0.08
+// Power iterations estimating rho(D^-1 A) for the prolongator smoother.
+#define ARTA_AMG_POWER_ITERS 15
+
+namespace arta {
+namespace linalg {
+  // Multigrid hierarchy of Galerkin coarse operators R A P, R = P^T, with
+  // a dense LU on the coarsest level. apply() runs one cycle from a zero
+  // guess: forward Gauss-Seidel (or damped Jacobi) before and backward
+  // Gauss-Seidel after every coarse correction, which keeps the cycle
+  // symmetric for use as a CG preconditioner. A cycle index of 1 gives
+  // V-cycles, 2 W-cycles. Subclasses choose the prolongators in setup().
+  class Multigrid : public Preconditioner {
+   public:
+    // smoother is "gs", "mcgs" (multicolor Gauss-Seidel, each color in
+    // parallel, see coloring.hpp) or "jacobi".
+    Multigrid(const std::string& smoother, unsigned sweeps, unsigned cycle);
+
+    // Not safe to call concurrently, the levels keep their vectors.
+    void apply(const Vector& x, Vector& y) const override;
+
+    inline unsigned levels() const noexcept { return levels_.size(); }
+    // Unknowns of level l, the finest being level 0.
+    unsigned long level_size(unsigned l) const;
+    // Stored entries of all levels over those of the finest.
+    double complexity() const;
+
+   protected:
+    // Starts a hierarchy with A as its finest level.
+    void reset(const Matrix& A);
+    inline unsigned long coarsest_size() const {
+      return levels_.back().A.size();
+    }
+    // Adds the level R A P below the coarsest one, P prolonging from it.
+    void add_level(SparseMatrix&& P);
+    // Adds a level by smoothed aggregation of the coarsest one. Returns
+    // false, adding nothing, if that no longer coarsens.
+    bool coarsen();
+    // Factors the coarsest level, once all levels are added.
+    void finish();
+
+   private:
+    struct Level {
+      Matrix A;
+      SparseMatrix P, R;
+      std::vector<double> dinv;
+      // Colors of A for the mcgs smoother.
+      Coloring colors;
+      // Right hand side, iterate and residual of the level, kept so a cycle
+      // does not allocate.
+      mutable Vector b, x, r;
+    };
+
+    void init_level(Level& level);
+    void cycle(unsigned l, const Vector& b, Vector& x, bool zero) const;
+    void smooth(const Level& level, const Vector& b, Vector& x,
+                bool backward) const;
+
+    bool jacobi_, colored_;
+    unsigned sweeps_, cycle_;
+    std::vector<Level> levels_;
+    // LU factors of the coarsest level, row major with partial pivoting.
+    std::vector<double> lu_;
+    std::vector<unsigned long> piv_;
+  };
+
+  // Smoothed aggregation algebraic multigrid. Every level aggregates
+  // strongly connected unknowns and smooths the piecewise constant
+  // tentative prolongator with one damped Jacobi step.
+  class AMG final : public Multigrid {
+   public:
+    explicit AMG(const std::string& smoother = "gs", unsigned sweeps = 1,
+                 unsigned cycle = 1);
+
+    void setup(const Matrix& A) override;
+  };
+
+  // Geometric multigrid on a nested mesh hierarchy, from the prolongators
+  // of its refinements, finest first (see mesh::Mesh::refine). Below the
+  // coarsest mesh the hierarchy continues by aggregation until the direct
+  // solve is small.
+  class GMG final : public Multigrid {
+   public:
+    explicit GMG(std::vector<SparseMatrix> prolongators,
+                 const std::string& smoother = "gs", unsigned sweeps = 1,
+                 unsigned cycle = 1);
+
+    void setup(const Matrix& A) override;
+
+   private:
+    std::vector<SparseMatrix> prolongators_;
+  };
+
+  // Standalone multigrid: cycles x += M^-1 (b - A x) until the residual
+  // meets opts.
+  SolverResult mg_solve(const Matrix& A, const Vector& b, Vector& x,
+                        Workspace& ws, const Multigrid& M,
+                        const SolverOptions& opts = SolverOptions());
+}  // namespace linalg
+}  // namespace arta
+
+#endif  // ARTA_LINALG_MULTIGRID_HPP_
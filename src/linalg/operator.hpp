@@ -0,0 +1,23 @@
+#ifndef ARTA_LINALG_OPERATOR_HPP_
+#define ARTA_LINALG_OPERATOR_HPP_
+
+#include "vector.hpp"
+
+namespace arta {
+namespace linalg {
+  // Anything that can form y = A x. The Krylov solvers only need this, so
+  // they run unchanged on any of the sparse storage formats.
+  template <typename _T>
+  class BasicOperator {
+   public:
+    virtual ~BasicOperator() {}
+    virtual unsigned long size() const noexcept = 0;
+    virtual void apply(const BasicVector<_T>& x, BasicVector<_T>& y) const = 0;
+  };
+
+  typedef BasicOperator<double> Operator;
+  typedef BasicOperator<float> Operatorf;
+}  // namespace linalg
+}  // namespace arta
+
+#endif  // ARTA_LINALG_OPERATOR_HPP_
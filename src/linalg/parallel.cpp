@@ -0,0 +1,116 @@
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+// Set on pool workers so nested parallel_for calls run inline instead of
+// waiting on the pool they are running in.
+thread_local bool in_pool_ = false;
+
+class ThreadPool {
+ public:
+  ThreadPool() : threads_(std::max(1u, std::thread::hardware_concurrency())) {}
+  ~ThreadPool() { stop(); }
+
+  unsigned get_threads() const { return threads_; }
+  void set_threads(unsigned n) {
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+    stop();
+    threads_ = std::max(1u, n);
+  }
+
+  void run(unsigned long begin, unsigned long end,
+           const arta::linalg::RangeFn& fn) {
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+    start();
+    unsigned long chunk = (end - begin + threads_ - 1) / threads_;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      fn_ = &fn;
+      begin_ = begin;
+      end_ = end;
+      chunk_ = chunk;
+      pending_ = workers_.size();
+      generation_++;
+    }
+    wake_.notify_all();
+    fn(begin, std::min(end, begin + chunk));
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return pending_ == 0; });
+    fn_ = nullptr;
+  }
+
+ private:
+  void start() {
+    if (!workers_.empty() || threads_ == 1) return;
+    quit_ = false;
+    for (unsigned id = 1; id < threads_; ++id) {
+      workers_.emplace_back(&ThreadPool::work, this, id, generation_);
+    }
+  }
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      quit_ = true;
+    }
+    wake_.notify_all();
+    for (auto& it : workers_) {
+      it.join();
+    }
+    workers_.clear();
+  }
+  void work(unsigned id, unsigned long seen) {
+    in_pool_ = true;
+    while (true) {
+      const arta::linalg::RangeFn* fn;
+      unsigned long begin, end;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [this, seen] { return quit_ || generation_ != seen; });
+        if (quit_) return;
+        seen = generation_;
+        fn = fn_;
+        begin = std::min(end_, begin_ + id * chunk_);
+        end = std::min(end_, begin + chunk_);
+      }
+      if (begin < end) (*fn)(begin, end);
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_--;
+      }
+      done_.notify_one();
+    }
+  }
+
+  unsigned threads_;
+  std::vector<std::thread> workers_;
+  std::mutex run_mutex_, mutex_;
+  std::condition_variable wake_, done_;
+  const arta::linalg::RangeFn* fn_ = nullptr;
+  unsigned long begin_ = 0, end_ = 0, chunk_ = 0, generation_ = 0;
+  unsigned long pending_ = 0;
+  bool quit_ = false;
+};
+
+ThreadPool& pool() {
+  static ThreadPool pool_;
+  return pool_;
+}
+}  // namespace
+
+unsigned arta::linalg::get_threads() { return pool().get_threads(); }
+void arta::linalg::set_threads(unsigned n) { pool().set_threads(n); }
+
+void arta::linalg::parallel_for(unsigned long begin, unsigned long end,
+                                RangeFn fn, unsigned long grain) {
+  if (begin >= end) return;
+  if (in_pool_ || pool().get_threads() == 1 || end - begin < grain) {
+    fn(begin, end);
+    return;
+  }
+  pool().run(begin, end, fn);
+}
@@ -0,0 +1,40 @@
+#ifndef ARTA_LINALG_PARALLEL_HPP_
+#define ARTA_LINALG_PARALLEL_HPP_
+
+namespace arta {
+namespace linalg {
+  unsigned get_threads();
+  void set_threads(unsigned n);
+
+  // Non-owning reference to a callable taking a [begin, end) range. Unlike
+  // std::function it never allocates, so the kernels can hand lambdas with
+  // large captures to parallel_for on every call.
+  class RangeFn {
+   public:
+    template <typename _F>
+    RangeFn(const _F& fn) : obj_(&fn), call_(&invoke<_F>) {}
+
+    inline void operator()(unsigned long begin, unsigned long end) const {
+      call_(obj_, begin, end);
+    }
+
+   private:
+    template <typename _F>
+    static void invoke(const void* obj, unsigned long begin,
+                       unsigned long end) {
+      (*static_cast<const _F*>(obj))(begin, end);
+    }
+
+    const void* obj_;
+    void (*call_)(const void*, unsigned long, unsigned long);
+  };
+
+  // Splits [begin, end) into one contiguous chunk per thread and runs fn on
+  // each chunk, returning once all chunks are done. Ranges shorter than
+  // grain are run inline on the calling thread.
+  void parallel_for(unsigned long begin, unsigned long end, RangeFn fn,
+                    unsigned long grain = 1024);
+}  // namespace linalg
+}  // namespace arta
+
+#endif  // ARTA_LINALG_PARALLEL_HPP_
@@ -0,0 +1,54 @@
+#include "pattern.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "geometry.hpp"
+
+arta::linalg::Pattern::Pattern() : size_(0), row_ptr_(1, 0) {}
+arta::linalg::Pattern::Pattern(unsigned long n,
+                               const std::vector<Triple<long>>& elements)
+    : size_(n), row_ptr_(n + 1, 0) {
+  std::vector<unsigned long> ele_ptr(n + 1, 0), ele_ind(3 * elements.size());
+  for (auto& it : elements) {
+    for (unsigned i = 0; i < 3; ++i) {
+      ele_ptr[it[i] + 1]++;
+    }
+  }
+  for (unsigned long v = 0; v < n; ++v) {
+    ele_ptr[v + 1] += ele_ptr[v];
+  }
+  std::vector<unsigned long> next(ele_ptr.begin(), ele_ptr.end() - 1);
+  for (unsigned long e = 0; e < elements.size(); ++e) {
+    for (unsigned i = 0; i < 3; ++i) {
+      ele_ind[next[elements[e][i]]++] = e;
+    }
+  }
+
+  std::vector<unsigned long> row;
+  for (unsigned long v = 0; v < n; ++v) {
+    row.clear();
+    for (unsigned long k = ele_ptr[v]; k < ele_ptr[v + 1]; ++k) {
+      for (unsigned i = 0; i < 3; ++i) {
+        row.push_back(elements[ele_ind[k]][i]);
+      }
+    }
+    std::sort(row.begin(), row.end());
+    row.erase(std::unique(row.begin(), row.end()), row.end());
+    col_ind_.insert(col_ind_.end(), row.begin(), row.end());
+    row_ptr_[v + 1] = col_ind_.size();
+  }
+
+  slots_.resize(9 * elements.size());
+  for (unsigned long e = 0; e < elements.size(); ++e) {
+    for (unsigned i = 0; i < 3; ++i) {
+      auto begin = col_ind_.begin() + row_ptr_[elements[e][i]];
+      auto end = col_ind_.begin() + row_ptr_[elements[e][i] + 1];
+      for (unsigned j = 0; j < 3; ++j) {
+        slots_[9 * e + 3 * i + j] = std::lower_bound(
+            begin, end, static_cast<unsigned long>(elements[e][j])) -
+            col_ind_.begin();
+      }
+    }
+  }
+}
@@ -0,0 +1,34 @@
+#ifndef ARTA_LINALG_PATTERN_HPP_
+#define ARTA_LINALG_PATTERN_HPP_
+
+#include <vector>
+
+#include "geometry.hpp"
+
+namespace arta {
+namespace linalg {
+  class Pattern {
+   public:
+    Pattern();
+    Pattern(unsigned long n, const std::vector<Triple<long>>& elements);
+
+    inline unsigned long size() const noexcept { return size_; }
+    inline unsigned long count() const noexcept { return col_ind_.size(); }
+
+    // Index into the values array of the entry coupling local vertices i and
+    // j of element e.
+    inline unsigned long slot(unsigned long e, unsigned i, unsigned j) const {
+      return slots_[9 * e + 3 * i + j];
+    }
+
+    const std::vector<unsigned long>* get_row_ptr() const { return &row_ptr_; }
+    const std::vector<unsigned long>* get_col_ind() const { return &col_ind_; }
+
+   private:
+    unsigned long size_;
+    std::vector<unsigned long> row_ptr_, col_ind_, slots_;
+  };
+}  // namespace linalg
+}  // namespace arta
+
+#endif  // ARTA_LINALG_PATTERN_HPP_
@@ -0,0 +1,241 @@
+#include "precond.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../logger.hpp"
+#include "coloring.hpp"
+#include "direct.hpp"
+#include "matrix.hpp"
+#include "multigrid.hpp"
+#include "vector.hpp"
+
+void arta::linalg::Jacobi::setup(const Matrix& A) {
+  const std::vector<unsigned long>& row_ptr = *A.get_row_ptr();
+  const std::vector<unsigned long>& col_ind = *A.get_col_ind();
+  const std::vector<double>& vals = *A.get_vals();
+  size_ = A.size();
+  dinv_.assign(size_, 1.0);
+  for (unsigned long i = 0; i < size_; ++i) {
+    for (unsigned long k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+      if (col_ind[k] == i && vals[k] != 0.0) {
+        dinv_[i] = 1.0 / vals[k];
+      }
+    }
+  }
+}
+void arta::linalg::Jacobi::apply(const Vector& x, Vector& y) const {
+  const double* xv = x.get_vals()->data();
+  double* yv = y.get_vals()->data();
+  for (unsigned long i = 0; i < size_; ++i) {
+    yv[i] = dinv_[i] * xv[i];
+  }
+}
+
+void arta::linalg::ILU0::setup(const Matrix& A) {
+  const std::vector<unsigned long>& row_ptr = *A.get_row_ptr();
+  const std::vector<unsigned long>& col_ind = *A.get_col_ind();
+  const std::vector<double>& vals = *A.get_vals();
+  size_ = A.size();
+  row_ptr_.assign(size_ + 1, 0);
+  diag_.assign(size_, 0);
+  col_ind_.clear();
+  vals_.clear();
+  col_ind_.reserve(col_ind.size());
+  vals_.reserve(vals.size());
+  // Copies A, adding a zero diagonal entry to rows that lack one.
+  for (unsigned long i = 0; i < size_; ++i) {
+    bool diag = false;
+    for (unsigned long k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+      if (!diag && col_ind[k] >= i) {
+        diag_[i] = col_ind_.size();
+        if (col_ind[k] != i) {
+          col_ind_.push_back(i);
+          vals_.push_back(0.0);
+        }
+        diag = true;
+      }
+      col_ind_.push_back(col_ind[k]);
+      vals_.push_back(vals[k]);
+    }
+    if (!diag) {
+      diag_[i] = col_ind_.size();
+      col_ind_.push_back(i);
+      vals_.push_back(0.0);
+    }
+    row_ptr_[i + 1] = col_ind_.size();
+  }
+  std::vector<unsigned long> pos(size_, row_ptr_[size_]);
+  unsigned long zero_pivots = 0;
+  for (unsigned long i = 0; i < size_; ++i) {
+    for (unsigned long k = row_ptr_[i]; k < row_ptr_[i + 1]; ++k) {
+      pos[col_ind_[k]] = k;
+    }
+    for (unsigned long k = row_ptr_[i]; k < diag_[i]; ++k) {
+      unsigned long c = col_ind_[k];
+      vals_[k] /= vals_[diag_[c]];
+      for (unsigned long kk = diag_[c] + 1; kk < row_ptr_[c + 1]; ++kk) {
+        if (pos[col_ind_[kk]] != row_ptr_[size_]) {
+          vals_[pos[col_ind_[kk]]] -= vals_[k] * vals_[kk];
+        }
+      }
+    }
+    if (vals_[diag_[i]] == 0.0) {
+      vals_[diag_[i]] = 1.0;
+      zero_pivots++;
+    }
+    for (unsigned long k = row_ptr_[i]; k < row_ptr_[i + 1]; ++k) {
+      pos[col_ind_[k]] = row_ptr_[size_];
+    }
+  }
+  if (zero_pivots != 0) {
+    log::warning("ILU(0) replaced %lu zero pivots", zero_pivots);
+  }
+}
+void arta::linalg::ILU0::apply(const Vector& x, Vector& y) const {
+  const double* xv = x.get_vals()->data();
+  double* yv = y.get_vals()->data();
+  for (unsigned long i = 0; i < size_; ++i) {
+    double sum = xv[i];
+    for (unsigned long k = row_ptr_[i]; k < diag_[i]; ++k) {
+      sum -= vals_[k] * yv[col_ind_[k]];
+    }
+    yv[i] = sum;
+  }
+  for (unsigned long i = size_; i-- > 0;) {
+    double sum = yv[i];
+    for (unsigned long k = diag_[i] + 1; k < row_ptr_[i + 1]; ++k) {
+      sum -= vals_[k] * yv[col_ind_[k]];
+    }
+    yv[i] = sum / vals_[diag_[i]];
+  }
+}
+
+void arta::linalg::IC0::setup(const Matrix& A) {
+  const std::vector<unsigned long>& row_ptr = *A.get_row_ptr();
+  const std::vector<unsigned long>& col_ind = *A.get_col_ind();
+  const std::vector<double>& vals = *A.get_vals();
+  size_ = A.size();
+  row_ptr_.assign(size_ + 1, 0);
+  col_ind_.clear();
+  vals_.clear();
+  for (unsigned long i = 0; i < size_; ++i) {
+    double diag = 0.0;
+    for (unsigned long k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+      if (col_ind[k] < i) {
+        col_ind_.push_back(col_ind[k]);
+        vals_.push_back(vals[k]);
+      } else if (col_ind[k] == i) {
+        diag = vals[k];
+      }
+    }
+    col_ind_.push_back(i);
+    vals_.push_back(diag);
+    row_ptr_[i + 1] = col_ind_.size();
+  }
+  std::vector<unsigned long> pos(size_, row_ptr_[size_]);
+  unsigned long breakdowns = 0;
+  for (unsigned long i = 0; i < size_; ++i) {
+    unsigned long last = row_ptr_[i + 1] - 1;
+    for (unsigned long k = row_ptr_[i]; k < last; ++k) {
+      pos[col_ind_[k]] = k;
+    }
+    // L_ij = (a_ij - sum_{m < j} L_im L_jm) / L_jj, in increasing j so the
+    // L_im needed are already final.
+    double diag = vals_[last];
+    for (unsigned long k = row_ptr_[i]; k < last; ++k) {
+      unsigned long j = col_ind_[k];
+      double sum = vals_[k];
+      for (unsigned long kk = row_ptr_[j]; kk < row_ptr_[j + 1] - 1; ++kk) {
+        if (pos[col_ind_[kk]] != row_ptr_[size_]) {
+          sum -= vals_[pos[col_ind_[kk]]] * vals_[kk];
+        }
+      }
+      vals_[k] = sum / vals_[row_ptr_[j + 1] - 1];
+      diag -= vals_[k] * vals_[k];
+    }
+    if (diag <= 0.0) {
+      // Not positive definite on this pattern, keep the original pivot.
+      diag = vals_[last] > 0.0 ? vals_[last] : 1.0;
+      breakdowns++;
+    }
+    vals_[last] = std::sqrt(diag);
+    for (unsigned long k = row_ptr_[i]; k < last; ++k) {
+      pos[col_ind_[k]] = row_ptr_[size_];
+    }
+  }
+  if (breakdowns != 0) {
+    log::warning("IC(0) replaced %lu non-positive pivots", breakdowns);
+  }
+}
+void arta::linalg::IC0::apply(const Vector& x, Vector& y) const {
+  const double* xv = x.get_vals()->data();
+  double* yv = y.get_vals()->data();
+  for (unsigned long i = 0; i < size_; ++i) {
+    double sum = xv[i];
+    unsigned long last = row_ptr_[i + 1] - 1;
+    for (unsigned long k = row_ptr_[i]; k < last; ++k) {
+      sum -= vals_[k] * yv[col_ind_[k]];
+    }
+    yv[i] = sum / vals_[last];
+  }
+  // L^T is walked by rows of L, scattering each solved entry upwards.
+  for (unsigned long i = size_; i-- > 0;) {
+    unsigned long last = row_ptr_[i + 1] - 1;
+    yv[i] /= vals_[last];
+    for (unsigned long k = row_ptr_[i]; k < last; ++k) {
+      yv[col_ind_[k]] -= vals_[k] * yv[i];
+    }
+  }
+}
+
+arta::linalg::SSOR::SSOR(const double& omega) : omega_(omega) {}
+void arta::linalg::SSOR::setup(const Matrix& A) {
+  const std::vector<unsigned long>& row_ptr = *A.get_row_ptr();
+  const std::vector<unsigned long>& col_ind = *A.get_col_ind();
+  const std::vector<double>& vals = *A.get_vals();
+  size_ = A.size();
+  A_ = A;
+  dinv_.assign(size_, 0.0);
+  for (unsigned long i = 0; i < size_; ++i) {
+    for (unsigned long k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+      if (col_ind[k] == i && vals[k] != 0.0) {
+        dinv_[i] = 1.0 / vals[k];
+      }
+    }
+  }
+  coloring_ = Coloring(A);
+}
+void arta::linalg::SSOR::apply(const Vector& x, Vector& y) const {
+  std::fill(y.get_vals()->begin(), y.get_vals()->end(), 0.0);
+  multicolor_sweep(A_, x, y, coloring_, dinv_.data(), omega_, false);
+  multicolor_sweep(A_, x, y, coloring_, dinv_.data(), omega_, true);
+}
+
+bool arta::linalg::is_preconditioner(const std::string& name) {
+  return name == "" || name == "none" || name == "jacobi" || name == "ilu0" ||
+         name == "ic0" || name == "ssor" || name == "amg" || name == "gmg" ||
+         name == "direct";
+}
+std::unique_ptr<arta::linalg::Preconditioner>
+arta::linalg::make_preconditioner(const std::string& name) {
+  if (name == "jacobi") {
+    return std::unique_ptr<Preconditioner>(new Jacobi());
+  } else if (name == "ilu0") {
+    return std::unique_ptr<Preconditioner>(new ILU0());
+  } else if (name == "ic0") {
+    return std::unique_ptr<Preconditioner>(new IC0());
+  } else if (name == "ssor") {
+    return std::unique_ptr<Preconditioner>(new SSOR());
+  } else if (name == "amg") {
+    return std::unique_ptr<Preconditioner>(new AMG());
+  } else if (name == "direct") {
+    return std::unique_ptr<Preconditioner>(new Direct());
+  } else if (!is_preconditioner(name)) {
+    log::warning("Unknown preconditioner \"%s\"", name.c_str());
+  }
+  return nullptr;
+}
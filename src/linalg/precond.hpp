@@ -0,0 +1,94 @@
+#ifndef ARTA_LINALG_PRECOND_HPP_
+#define ARTA_LINALG_PRECOND_HPP_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "coloring.hpp"
+#include "matrix.hpp"
+#include "operator.hpp"
+#include "vector.hpp"
+
+// Relaxation factor of the SSOR preconditioner, 1 giving symmetric
+// Gauss-Seidel.
+#define ARTA_SSOR_OMEGA 1.0
+
+namespace arta {
+namespace linalg {
+  // Approximate inverse M^-1 of a matrix. setup() builds it from A, after
+  // which apply(x, y) forms y = M^-1 x, so a preconditioner can be passed
+  // anywhere the solvers take an Operator.
+  class Preconditioner : public Operator {
+   public:
+    virtual void setup(const Matrix& A) = 0;
+    inline unsigned long size() const noexcept override { return size_; }
+
+   protected:
+    unsigned long size_ = 0;
+  };
+
+  // Diagonal scaling, M = diag(A).
+  class Jacobi final : public Preconditioner {
+   public:
+    void setup(const Matrix& A) override;
+    void apply(const Vector& x, Vector& y) const override;
+
+   private:
+    std::vector<double> dinv_;
+  };
+
+  // Zero fill incomplete LU, M = L U with L unit lower and U upper
+  // triangular on the pattern of A. Both factors share one CSR array.
+  class ILU0 final : public Preconditioner {
+   public:
+    void setup(const Matrix& A) override;
+    void apply(const Vector& x, Vector& y) const override;
+
+   private:
+    std::vector<unsigned long> row_ptr_, col_ind_, diag_;
+    std::vector<double> vals_;
+  };
+
+  // Zero fill incomplete Cholesky, M = L L^T on the lower triangle of A,
+  // which is assumed to be symmetric positive definite.
+  class IC0 final : public Preconditioner {
+   public:
+    void setup(const Matrix& A) override;
+    void apply(const Vector& x, Vector& y) const override;
+
+   private:
+    // Rows of L, the diagonal entry last in every row.
+    std::vector<unsigned long> row_ptr_, col_ind_;
+    std::vector<double> vals_;
+  };
+
+  // Symmetric SOR, one forward and one backward multicolor sweep from
+  // zero (see coloring.hpp), each color in parallel. M is symmetric for
+  // symmetric A, so it also serves CG.
+  class SSOR final : public Preconditioner {
+   public:
+    explicit SSOR(const double& omega = ARTA_SSOR_OMEGA);
+
+    void setup(const Matrix& A) override;
+    void apply(const Vector& x, Vector& y) const override;
+
+    inline const Coloring& coloring() const noexcept { return coloring_; }
+
+   private:
+    double omega_;
+    Matrix A_;
+    std::vector<double> dinv_;
+    Coloring coloring_;
+  };
+
+  // Preconditioner by name: "jacobi", "ilu0", "ic0", "ssor", "amg" (see
+  // multigrid.hpp) or "direct" (see direct.hpp). Returns nullptr for "" or
+  // "none", for "gmg", which needs the mesh hierarchy of a GMG, and for
+  // unknown names after reporting them.
+  std::unique_ptr<Preconditioner> make_preconditioner(const std::string& name);
+  bool is_preconditioner(const std::string& name);
+}  // namespace linalg
+}  // namespace arta
+
+#endif  // ARTA_LINALG_PRECOND_HPP_
@@ -0,0 +1,164 @@
+#include "sell.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "matrix.hpp"
+#include "parallel.hpp"
+#include "vector.hpp"
+
+namespace {
+const unsigned long C = ARTA_SELL_CHUNK;
+
+#if defined(__AVX512F__)
+inline void chunk_kernel(const unsigned long* col, const double* vals,
+                         unsigned long len, const double* x, double* acc) {
+  __m512d sum = _mm512_setzero_pd();
+  for (unsigned long j = 0; j < len; ++j, col += C, vals += C) {
+    __m512i idx = _mm512_loadu_si512(col);
+    __m512d xg = _mm512_i64gather_pd(idx, x, sizeof(double));
+    sum = _mm512_fmadd_pd(_mm512_loadu_pd(vals), xg, sum);
+  }
+  _mm512_storeu_pd(acc, sum);
+}
+#elif defined(__AVX2__)
+inline __m256d madd(__m256d a, __m256d b, __m256d c) {
+#if defined(__FMA__)
+  return _mm256_fmadd_pd(a, b, c);
+#else
+  return _mm256_add_pd(_mm256_mul_pd(a, b), c);
+#endif
+}
+inline void chunk_kernel(const unsigned long* col, const double* vals,
+                         unsigned long len, const double* x, double* acc) {
+  __m256d lo = _mm256_setzero_pd(), hi = _mm256_setzero_pd();
+  for (unsigned long j = 0; j < len; ++j, col += C, vals += C) {
+    __m256i idx_lo = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(col));
+    __m256i idx_hi =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(col + 4));
+    lo = madd(_mm256_loadu_pd(vals),
+              _mm256_i64gather_pd(x, idx_lo, sizeof(double)), lo);
+    hi = madd(_mm256_loadu_pd(vals + 4),
+              _mm256_i64gather_pd(x, idx_hi, sizeof(double)), hi);
+  }
+  _mm256_storeu_pd(acc, lo);
+  _mm256_storeu_pd(acc + 4, hi);
+}
+#else
+inline void chunk_kernel(const unsigned long* col, const double* vals,
+                         unsigned long len, const double* x, double* acc) {
+  for (unsigned long i = 0; i < C; ++i) {
+    acc[i] = 0.0;
+  }
+  for (unsigned long j = 0; j < len; ++j, col += C, vals += C) {
+    for (unsigned long i = 0; i < C; ++i) {
+      acc[i] += vals[i] * x[col[i]];
+    }
+  }
+}
+#endif
+}  // namespace
+
+arta::linalg::SellMatrix::SellMatrix() : size_(0), nnz_(0) {}
+arta::linalg::SellMatrix::SellMatrix(const Matrix& mat, unsigned long sigma)
+    : size_(mat.size()), nnz_(mat.count()) {
+  const std::vector<unsigned long>& row_ptr = *mat.get_row_ptr();
+  const std::vector<unsigned long>& col_ind = *mat.get_col_ind();
+  const std::vector<double>& vals = *mat.get_vals();
+  unsigned long n_chunks = (size_ + C - 1) / C;
+  sigma = std::max(C, sigma - sigma % C);
+
+  perm_.resize(n_chunks * C, size_);
+  std::iota(perm_.begin(), perm_.begin() + size_, 0ul);
+  for (unsigned long begin = 0; begin < size_; begin += sigma) {
+    std::stable_sort(perm_.begin() + begin,
+                     perm_.begin() + std::min(size_, begin + sigma),
+                     [&row_ptr](unsigned long a, unsigned long b) {
+                       return row_ptr[a + 1] - row_ptr[a] >
+                              row_ptr[b + 1] - row_ptr[b];
+                     });
+  }
+
+  chunk_ptr_.resize(n_chunks + 1, 0);
+  chunk_len_.resize(n_chunks, 0);
+  for (unsigned long c = 0; c < n_chunks; ++c) {
+    for (unsigned long i = 0; i < C; ++i) {
+      unsigned long r = perm_[c * C + i];
+      if (r < size_) {
+        chunk_len_[c] = std::max(chunk_len_[c], row_ptr[r + 1] - row_ptr[r]);
+      }
+    }
+    chunk_ptr_[c + 1] = chunk_ptr_[c] + chunk_len_[c] * C;
+  }
+
+  col_ind_.resize(chunk_ptr_[n_chunks]);
+  vals_.resize(chunk_ptr_[n_chunks], 0.0);
+  for (unsigned long c = 0; c < n_chunks; ++c) {
+    for (unsigned long i = 0; i < C; ++i) {
+      unsigned long r = perm_[c * C + i];
+      unsigned long len = r < size_ ? row_ptr[r + 1] - row_ptr[r] : 0;
+      for (unsigned long j = 0; j < chunk_len_[c]; ++j) {
+        unsigned long k = chunk_ptr_[c] + j * C + i;
+        if (j < len) {
+          col_ind_[k] = col_ind[row_ptr[r] + j];
+          vals_[k] = vals[row_ptr[r] + j];
+        } else {
+          col_ind_[k] = r < size_ ? r : 0;
+        }
+      }
+    }
+  }
+}
+
+void arta::linalg::SellMatrix::apply(const Vector& x, Vector& y) const {
+  multiply(*this, x, y);
+}
+
+double arta::linalg::SellMatrix::fill() const {
+  if (vals_.empty()) return 0.0;
+  return 1.0 - static_cast<double>(nnz_) / vals_.size();
+}
+
+std::string arta::linalg::SellMatrix::kernel() {
+#if defined(__AVX512F__)
+  return "avx512";
+#elif defined(__AVX2__)
+  return "avx2";
+#else
+  return "scalar";
+#endif
+}
+
+void arta::linalg::multiply(const SellMatrix& A, const Vector& x, Vector& y) {
+  if (y.size() != A.size()) {
+    y = Vector(A.size());
+  }
+  const unsigned long n = A.size();
+  const unsigned long* perm = A.perm_.data();
+  const unsigned long* chunk_ptr = A.chunk_ptr_.data();
+  const unsigned long* chunk_len = A.chunk_len_.data();
+  const unsigned long* col_ind = A.col_ind_.data();
+  const double* vals = A.vals_.data();
+  const double* xv = x.get_vals()->data();
+  double* yv = y.get_vals()->data();
+  parallel_for(
+      0, A.chunks(),
+      [=](unsigned long begin, unsigned long end) {
+        double acc[C];
+        for (unsigned long c = begin; c < end; ++c) {
+          chunk_kernel(col_ind + chunk_ptr[c], vals + chunk_ptr[c],
+                       chunk_len[c], xv, acc);
+          for (unsigned long i = 0; i < C; ++i) {
+            unsigned long r = perm[c * C + i];
+            if (r < n) yv[r] = acc[i];
+          }
+        }
+      },
+      128);
+}
@@ -0,0 +1,51 @@
+#ifndef ARTA_LINALG_SELL_HPP_
+#define ARTA_LINALG_SELL_HPP_
+
+#include <string>
+#include <vector>
+
+#include "matrix.hpp"
+#include "operator.hpp"
+#include "vector.hpp"
+
+#define ARTA_SELL_CHUNK 8
+#define ARTA_SELL_SIGMA 256
+
+namespace arta {
+namespace linalg {
+  // Sliced ELLPACK (SELL-C-sigma) storage. Rows are sorted by length inside
+  // windows of sigma rows, then grouped into chunks of C rows that are padded
+  // to the longest row of the chunk and stored column-major, so one SIMD
+  // lane handles one row.
+  class SellMatrix final : public Operator {
+   public:
+    SellMatrix();
+    explicit SellMatrix(const Matrix& mat,
+                        unsigned long sigma = ARTA_SELL_SIGMA);
+
+    inline unsigned long size() const noexcept override { return size_; }
+    inline unsigned long count() const noexcept { return vals_.size(); }
+    inline unsigned long chunks() const noexcept {
+      return chunk_len_.size();
+    }
+
+    void apply(const Vector& x, Vector& y) const override;
+
+    // Fraction of stored entries that are padding.
+    double fill() const;
+
+    static std::string kernel();
+
+   private:
+    friend void multiply(const SellMatrix& A, const Vector& x, Vector& y);
+
+    unsigned long size_, nnz_;
+    std::vector<unsigned long> perm_, chunk_ptr_, chunk_len_, col_ind_;
+    std::vector<double> vals_;
+  };
+
+  void multiply(const SellMatrix& A, const Vector& x, Vector& y);
+}  // namespace linalg
+}  // namespace arta
+
+#endif  // ARTA_LINALG_SELL_HPP_
@@ -1,71 +1,532 @@
 #include "solver.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include "../logger.hpp"
+#include "blas.hpp"
+#include "coloring.hpp"
+#include "direct.hpp"
 #include "matrix.hpp"
+#include "mixed.hpp"
+#include "multigrid.hpp"
+#include "operator.hpp"
+#include "precond.hpp"
 #include "vector.hpp"
+#include "workspace.hpp"
 
 #include <iostream>
 
 bool arta::linalg::diag_dominant(const Matrix& A) {
-  for (unsigned i = 0; i < A.size(); ++i) {
-    double sum = 0.0;
-    for (unsigned j = 0; j < A.size(); ++j) {
-      if (i == j) continue;
-      sum += std::fabs(A.at(i, j));
+  const std::vector<unsigned long>& row_ptr = *A.get_row_ptr();
+  const std::vector<unsigned long>& col_ind = *A.get_col_ind();
+  const std::vector<double>& vals = *A.get_vals();
+  for (unsigned long i = 0; i < A.size(); ++i) {
+    double sum = 0.0, diag = 0.0;
+    for (unsigned long k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+      if (col_ind[k] == i) {
+        diag = std::fabs(vals[k]);
+      } else {
+        sum += std::fabs(vals[k]);
+      }
     }
-    if (std::fabs(A.at(i, i)) < sum) return false;
+    if (diag < sum) return false;
   }
   return true;
 }
 
-arta::linalg::Vector arta::linalg::gauss_seidel(const Matrix& A,
-                                                const Vector& b,
-                                                const unsigned& n) {
-  Vector x(b.size());
+void arta::linalg::SolverResult::start(const double& norm_b,
+                                       const SolverOptions& opts) {
+  iterations = 0;
+  residual = 0.0;
+  tolerance = std::max(opts.rtol * norm_b, opts.atol);
+  converged = false;
+  record = opts.history;
+  history.clear();
+}
+bool arta::linalg::SolverResult::update(const unsigned& it,
+                                        const double& res) {
+  if (record) {
+    if (!history.empty() && it == iterations) {
+      history.back() = res;
+    } else {
+      history.push_back(res);
+    }
+  }
+  iterations = it;
+  residual = res;
+  converged = res <= tolerance;
+  return converged;
+}
+
+namespace {
+// Sizes x to b and clears it, reusing its storage when it already fits,
+// unless opts asks to start from x. Returns whether x may be non-zero.
+template <typename _T>
+bool initial_guess(const arta::linalg::BasicVector<_T>& b,
+                   arta::linalg::BasicVector<_T>& x,
+                   const arta::linalg::SolverOptions& opts) {
+  if (x.size() != b.size()) {
+    x = arta::linalg::BasicVector<_T>(b.size());
+    return false;
+  } else if (!opts.guess) {
+    std::fill(x.get_vals()->begin(), x.get_vals()->end(), 0.0);
+    return false;
+  }
+  return true;
+}
+}  // namespace
+
+namespace {
+// x_i += omega (b_i - A_i x) / a_ii for row i, with dinv holding 1 / a_ii.
+inline void relax_row(unsigned long i, const unsigned long* row_ptr,
+                      const unsigned long* col_ind, const double* vals,
+                      const double* bv, const double* dinv,
+                      const double& omega, double* xv) {
+  double sum = bv[i];
+  for (unsigned long k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+    sum -= vals[k] * xv[col_ind[k]];
+  }
+  xv[i] += omega * sum * dinv[i];
+}
+
+// Forward (and for SSOR also backward) relaxation sweeps, in row order or
+// by the colors of colors, checking the residual after every opts.check
+// sweeps and after the last.
+arta::linalg::SolverResult relax(const arta::linalg::Matrix& A,
+                                 const arta::linalg::Vector& b,
+                                 arta::linalg::Vector& x,
+                                 arta::linalg::Workspace& ws,
+                                 const double& omega, bool symmetric,
+                                 const arta::linalg::SolverOptions& opts,
+                                 const arta::linalg::Coloring* colors) {
+  const unsigned long* row_ptr = A.get_row_ptr()->data();
+  const unsigned long* col_ind = A.get_col_ind()->data();
+  const double* vals = A.get_vals()->data();
+  const double* bv = b.get_vals()->data();
+  unsigned long size = b.size();
+  ws.resize(size);
+  initial_guess(b, x, opts);
+  arta::linalg::Vector& dinv = ws.acquire();
+  arta::linalg::Vector& r = ws.acquire();
+  double* dv = dinv.get_vals()->data();
+  for (unsigned long i = 0; i < size; ++i) {
+    dv[i] = 0.0;
+    for (unsigned long k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+      if (col_ind[k] == i) {
+        dv[i] = 1.0 / vals[k];
+      }
+    }
+  }
+  arta::linalg::SolverResult result;
+  result.start(nrm2(b), opts);
+  double* xv = x.get_vals()->data();
+  unsigned n = opts.max_iters;
   for (unsigned k = 0; k < n; ++k) {
-    for (unsigned i = 0; i < b.size(); ++i) {
-      double sigma = 0.0;
-      for (unsigned j = 0; j < b.size(); ++j) {
-        if (i == j) continue;
-        sigma += A.at(i, j) * x.at(j);
+    if (colors != nullptr) {
+      arta::linalg::multicolor_sweep(A, b, x, *colors, dv, omega, false);
+      if (symmetric) {
+        arta::linalg::multicolor_sweep(A, b, x, *colors, dv, omega, true);
+      }
+    } else {
+      for (unsigned long i = 0; i < size; ++i) {
+        relax_row(i, row_ptr, col_ind, vals, bv, dv, omega, xv);
+      }
+    }
+    if (symmetric && colors == nullptr) {
+      for (unsigned long i = size; i-- > 0;) {
+        relax_row(i, row_ptr, col_ind, vals, bv, dv, omega, xv);
       }
-      x.set(i, (b.at(i) - sigma) / A.at(i, i));
     }
-    if (norm(A * x - b) <= 1e-20) break;
+    if ((k + 1) % std::max(opts.check, 1u) == 0 || k + 1 == n) {
+      arta::linalg::multiply(A, x, r);
+      arta::linalg::axpy(-1.0, b, r);
+      if (result.update(k + 1, arta::linalg::nrm2(r))) break;
+    }
   }
+  return result;
+}
+}  // namespace
+
+arta::linalg::Vector arta::linalg::gauss_seidel(const Matrix& A,
+                                                const Vector& b,
+                                                const unsigned& n) {
+  Workspace ws(b.size());
+  Vector x(b.size());
+  SolverOptions opts;
+  opts.max_iters = n;
+  gauss_seidel(A, b, x, ws, opts);
   return x;
 }
+arta::linalg::SolverResult arta::linalg::gauss_seidel(
+    const Matrix& A, const Vector& b, Vector& x, Workspace& ws,
+    const SolverOptions& opts) {
+  return relax(A, b, x, ws, 1.0, false, opts, nullptr);
+}
+arta::linalg::SolverResult arta::linalg::sor(const Matrix& A, const Vector& b,
+                                             Vector& x, Workspace& ws,
+                                             const double& omega,
+                                             const SolverOptions& opts) {
+  return relax(A, b, x, ws, omega, false, opts, nullptr);
+}
+arta::linalg::SolverResult arta::linalg::ssor(const Matrix& A,
+                                              const Vector& b, Vector& x,
+                                              Workspace& ws,
+                                              const double& omega,
+                                              const SolverOptions& opts) {
+  return relax(A, b, x, ws, omega, true, opts, nullptr);
+}
 
-arta::linalg::Vector arta::linalg::conjugate_gradient(const Matrix& A,
+arta::linalg::SolverResult arta::linalg::gauss_seidel(
+    const Matrix& A, const Vector& b, Vector& x, Workspace& ws,
+    const Coloring& colors, const SolverOptions& opts) {
+  return relax(A, b, x, ws, 1.0, false, opts, &colors);
+}
+arta::linalg::SolverResult arta::linalg::ssor(const Matrix& A,
+                                              const Vector& b, Vector& x,
+                                              Workspace& ws,
+                                              const Coloring& colors,
+                                              const double& omega,
+                                              const SolverOptions& opts) {
+  return relax(A, b, x, ws, omega, true, opts, &colors);
+}
+
+arta::linalg::Vector arta::linalg::conjugate_gradient(const Operator& A,
                                                       const Vector& b,
                                                       const unsigned& n) {
+  Workspace ws(b.size());
   Vector x(b.size());
-  Vector r = b - A * x;
-  Vector p = r;
-  double rho_prev = dot(r, r);
-  for (unsigned i = 0; i < n && rho_prev > 1e-20; ++i) {
-    Vector Ap = A * p;
+  SolverOptions opts;
+  opts.max_iters = n;
+  conjugate_gradient(A, b, x, ws, opts);
+  return x;
+}
+template <typename _T>
+arta::linalg::SolverResult arta::linalg::conjugate_gradient(
+    const BasicOperator<_T>& A, const BasicVector<_T>& b, BasicVector<_T>& x,
+    BasicWorkspace<_T>& ws, const SolverOptions& opts,
+    const BasicOperator<_T>* M) {
+  ws.resize(b.size());
+  bool guess = initial_guess(b, x, opts);
+  BasicVector<_T>& r = ws.acquire();
+  BasicVector<_T>& p = ws.acquire();
+  BasicVector<_T>& Ap = ws.acquire();
+  // The preconditioned residual, which is r itself without M.
+  BasicVector<_T>& z = M != nullptr ? ws.acquire() : r;
+  if (guess) {
+    A.apply(x, r);
+    axpby(1.0, b, -1.0, r);
+  } else {
+    r = b;
+  }
+  if (M != nullptr) {
+    M->apply(r, z);
+  }
+  p = z;
+  SolverResult result;
+  result.start(nrm2(b), opts);
+  double rho_prev = dot(r, z);
+  if (result.update(0, nrm2(r))) return result;
+  for (unsigned i = 0; i < opts.max_iters; ++i) {
+    A.apply(p, Ap);
     double alpha = rho_prev / dot(p, Ap);
-    x += p * alpha;
-    r -= Ap * alpha;
-    double rho_new = dot(r, r);
-    if (rho_new < 1e-20) {
-      break;
+    axpy(alpha, p, x);
+    axpy(-alpha, Ap, r);
+    if (result.update(i + 1, nrm2(r))) break;
+    if (M != nullptr) {
+      M->apply(r, z);
     }
-    p = r + p * (rho_new / rho_prev);
+    double rho_new = dot(r, z);
+    axpby(1.0, z, rho_new / rho_prev, p);
     rho_prev = rho_new;
   }
+  return result;
+}
+
+arta::linalg::Vector arta::linalg::gmres(const Operator& A, const Vector& b,
+                                         const unsigned& n) {
+  Workspace ws(b.size());
+  Vector x(b.size());
+  SolverOptions opts;
+  opts.max_iters = n;
+  gmres(A, b, x, ws, opts);
   return x;
 }
+template <typename _T>
+arta::linalg::SolverResult arta::linalg::gmres(const BasicOperator<_T>& A,
+                                               const BasicVector<_T>& b,
+                                               BasicVector<_T>& x,
+                                               BasicWorkspace<_T>& ws,
+                                               const SolverOptions& opts,
+                                               const BasicOperator<_T>* M) {
+  unsigned m = std::max(opts.restart, 1u), n = opts.max_iters;
+  ws.resize(b.size());
+  initial_guess(b, x, opts);
+  BasicVector<_T>& r = ws.acquire();
+  BasicVector<_T>& z = ws.acquire();
+  // Krylov basis, Hessenberg matrix (column major, m + 1 rows), Givens
+  // rotations and the rotated right hand side, kept per thread so repeated
+  // solves do not allocate.
+  thread_local std::vector<BasicVector<_T>*> basis;
+  thread_local std::vector<double> hess;
+  basis.resize(m + 1);
+  for (unsigned i = 0; i <= m; ++i) {
+    basis[i] = &ws.acquire();
+  }
+  if (hess.size() < (m + 1) * m + 3 * m + 1) {
+    hess.resize((m + 1) * m + 3 * m + 1);
+  }
+  double* H = hess.data();
+  double* cs = H + (m + 1) * m;
+  double* sn = cs + m;
+  double* g = sn + m;
+  SolverResult result;
+  result.start(nrm2(b), opts);
+  unsigned it = 0;
+  while (it < n) {
+    A.apply(x, r);
+    axpby(1.0, b, -1.0, r);
+    // The true residual, replacing the estimate after a restart.
+    double beta = nrm2(r);
+    if (result.update(it, beta)) break;
+    *basis[0] = r;
+    scal(1.0 / beta, *basis[0]);
+    std::fill(g, g + m + 1, 0.0);
+    g[0] = beta;
+    unsigned k = 0;
+    while (k < m && it < n && !result.converged) {
+      double* h = H + k * (m + 1);
+      BasicVector<_T>& w = *basis[k + 1];
+      if (M != nullptr) {
+        M->apply(*basis[k], z);
+        A.apply(z, w);
+      } else {
+        A.apply(*basis[k], w);
+      }
+      // Modified Gram-Schmidt against the basis so far.
+      for (unsigned i = 0; i <= k; ++i) {
+        h[i] = dot(w, *basis[i]);
+        axpy(-h[i], *basis[i], w);
+      }
+      h[k + 1] = nrm2(w);
+      if (h[k + 1] != 0.0) {
+        scal(1.0 / h[k + 1], w);
+      }
+      for (unsigned i = 0; i < k; ++i) {
+        double t = cs[i] * h[i] + sn[i] * h[i + 1];
+        h[i + 1] = -sn[i] * h[i] + cs[i] * h[i + 1];
+        h[i] = t;
+      }
+      double d = std::hypot(h[k], h[k + 1]);
+      cs[k] = d != 0.0 ? h[k] / d : 1.0;
+      sn[k] = d != 0.0 ? h[k + 1] / d : 0.0;
+      h[k] = d;
+      h[k + 1] = 0.0;
+      g[k + 1] = -sn[k] * g[k];
+      g[k] = cs[k] * g[k];
+      ++k;
+      ++it;
+      result.update(it, std::fabs(g[k]));
+    }
+    // Solve the k x k triangular system in place of g, then x += M^-1 V y.
+    for (unsigned i = k; i-- > 0;) {
+      for (unsigned j = i + 1; j < k; ++j) {
+        g[i] -= H[j * (m + 1) + i] * g[j];
+      }
+      g[i] /= H[i * (m + 1) + i];
+    }
+    std::fill(r.get_vals()->begin(), r.get_vals()->end(), 0.0);
+    for (unsigned i = 0; i < k; ++i) {
+      axpy(g[i], *basis[i], r);
+    }
+    if (M != nullptr) {
+      M->apply(r, z);
+      axpy(1.0, z, x);
+    } else {
+      axpy(1.0, r, x);
+    }
+    if (result.converged) break;
+  }
+  return result;
+}
 
+arta::linalg::Vector arta::linalg::bicgstab(const Operator& A,
+                                            const Vector& b,
+                                            const unsigned& n) {
+  Workspace ws(b.size());
+  Vector x(b.size());
+  SolverOptions opts;
+  opts.max_iters = n;
+  bicgstab(A, b, x, ws, opts);
+  return x;
+}
+template <typename _T>
+arta::linalg::SolverResult arta::linalg::bicgstab(
+    const BasicOperator<_T>& A, const BasicVector<_T>& b, BasicVector<_T>& x,
+    BasicWorkspace<_T>& ws, const SolverOptions& opts,
+    const BasicOperator<_T>* M) {
+  ws.resize(b.size());
+  bool guess = initial_guess(b, x, opts);
+  BasicVector<_T>& r = ws.acquire();
+  BasicVector<_T>& r0 = ws.acquire();
+  BasicVector<_T>& p = ws.acquire();
+  BasicVector<_T>& v = ws.acquire();
+  BasicVector<_T>& t = ws.acquire();
+  // Without a preconditioner the preconditioned directions are p and s
+  // themselves, s being kept in r.
+  BasicVector<_T>& p_hat = M != nullptr ? ws.acquire() : p;
+  BasicVector<_T>& s_hat = M != nullptr ? ws.acquire() : r;
+  if (guess) {
+    A.apply(x, r);
+    axpby(1.0, b, -1.0, r);
+  } else {
+    r = b;
+  }
+  r0 = r;
+  std::fill(p.get_vals()->begin(), p.get_vals()->end(), 0.0);
+  std::fill(v.get_vals()->begin(), v.get_vals()->end(), 0.0);
+  SolverResult result;
+  result.start(nrm2(b), opts);
+  double rho = 1.0, alpha = 1.0, omega = 1.0;
+  if (result.update(0, nrm2(r))) return result;
+  for (unsigned i = 0; i < opts.max_iters; ++i) {
+    double rho_new = dot(r0, r);
+    if (rho_new == 0.0) break;
+    axpy(-omega, v, p);
+    axpby(1.0, r, (rho_new / rho) * (alpha / omega), p);
+    if (M != nullptr) {
+      M->apply(p, p_hat);
+    }
+    A.apply(p_hat, v);
+    alpha = rho_new / dot(r0, v);
+    axpy(-alpha, v, r);
+    if (result.update(i + 1, nrm2(r))) {
+      axpy(alpha, p_hat, x);
+      break;
+    }
+    if (M != nullptr) {
+      M->apply(r, s_hat);
+    }
+    A.apply(s_hat, t);
+    omega = dot(t, r) / dot(t, t);
+    axpy(alpha, p_hat, x);
+    axpy(omega, s_hat, x);
+    axpy(-omega, t, r);
+    if (result.update(i + 1, nrm2(r)) || omega == 0.0) break;
+    rho = rho_new;
+  }
+  return result;
+}
+
+#define ARTA_INSTANTIATE_SOLVERS(_T)                                       \
+  template arta::linalg::SolverResult arta::linalg::conjugate_gradient(     \
+      const BasicOperator<_T>&, const BasicVector<_T>&, BasicVector<_T>&,  \
+      BasicWorkspace<_T>&, const SolverOptions&, const BasicOperator<_T>*); \
+  template arta::linalg::SolverResult arta::linalg::gmres(                  \
+      const BasicOperator<_T>&, const BasicVector<_T>&, BasicVector<_T>&,  \
+      BasicWorkspace<_T>&, const SolverOptions&, const BasicOperator<_T>*); \
+  template arta::linalg::SolverResult arta::linalg::bicgstab(               \
+      const BasicOperator<_T>&, const BasicVector<_T>&, BasicVector<_T>&,  \
+      BasicWorkspace<_T>&, const SolverOptions&, const BasicOperator<_T>*);
+
+ARTA_INSTANTIATE_SOLVERS(double)
+ARTA_INSTANTIATE_SOLVERS(float)
+
+bool arta::linalg::is_solver(const std::string& method) {
+  return method == "" || method == "gmres" || method == "bicgstab" ||
+         method == "cg" || method == "gs" || method == "mcgs" ||
+         method == "amg" || method == "gmg" || method == "direct";
+}
 arta::linalg::Vector arta::linalg::solve(const Matrix& A, const Vector& b,
-                                         const unsigned& n) {
-  // TODO Conjugate Gradient only works for symmetric and positive definite!
-  // Gauss-Seidel is working because it is diagonal dominant.
-  // I will need to use GMRES to solve it any faster. This means leaning more
-  // about the Krylov subspace, and the Arnoldi iterations.
-  // return conjugate_gradient(A, b, n);
-  return gauss_seidel(A, b, n);
+                                         const unsigned& n,
+                                         const std::string& method,
+                                         const Operator* M) {
+  Workspace ws(b.size());
+  Vector x(b.size());
+  SolverOptions opts;
+  opts.method = method;
+  opts.max_iters = n;
+  solve(A, b, x, ws, opts, M);
+  return x;
+}
+arta::linalg::SolverResult arta::linalg::solve(const Matrix& A,
+                                               const Vector& b, Vector& x,
+                                               Workspace& ws,
+                                               const SolverOptions& opts,
+                                               const Operator* M) {
+  const std::string& method = opts.method;
+  if (opts.mixed) {
+    const MixedPrecision* mixed = dynamic_cast<const MixedPrecision*>(M);
+    if (mixed != nullptr && mixed->size() == A.size()) {
+      return mixed_solve(A, b, x, ws, *mixed, opts);
+    }
+    MixedPrecision inner(opts, make_preconditioner(opts.precond));
+    inner.setup(A);
+    return mixed_solve(A, b, x, ws, inner, opts);
+  }
+  std::unique_ptr<Preconditioner> local;
+  if (M == nullptr && method != "gs" && method != "mcgs") {
+    local = make_preconditioner(opts.precond);
+    if (local) {
+      local->setup(A);
+      M = local.get();
+    }
+  }
+  if (method == "bicgstab") {
+    return bicgstab(A, b, x, ws, opts, M);
+  } else if (method == "cg") {
+    return conjugate_gradient(A, b, x, ws, opts, M);
+  } else if (method == "gs") {
+    return gauss_seidel(A, b, x, ws, opts);
+  } else if (method == "mcgs") {
+    // Reuses the coloring of M when it is a multicolor SSOR of A.
+    const SSOR* ssor = dynamic_cast<const SSOR*>(M);
+    if (ssor != nullptr && ssor->size() == A.size()) {
+      return gauss_seidel(A, b, x, ws, ssor->coloring(), opts);
+    }
+    return gauss_seidel(A, b, x, ws, Coloring(A), opts);
+  } else if (method == "direct") {
+    // One factorization serves every right hand side, so M is used when it
+    // already holds one.
+    const Direct* direct = dynamic_cast<const Direct*>(M);
+    Direct factor;
+    if (direct == nullptr || direct->size() != A.size()) {
+      factor.setup(A);
+      direct = &factor;
+    }
+    if (x.size() != b.size()) {
+      x = Vector(b.size());
+    }
+    direct->apply(b, x);
+    ws.resize(b.size());
+    Vector& r = ws.acquire();
+    multiply(A, x, r);
+    axpby(1.0, b, -1.0, r);
+    SolverResult result;
+    result.start(nrm2(b), opts);
+    result.update(1, nrm2(r));
+    return result;
+  } else if (method == "amg" || method == "gmg") {
+    // Reuses the hierarchy when M is one, building one is far more costly
+    // than a solve.
+    const Multigrid* mg = dynamic_cast<const Multigrid*>(M);
+    if (mg != nullptr) {
+      return mg_solve(A, b, x, ws, *mg, opts);
+    }
+    if (method == "gmg") {
+      log::warning("gmg needs a mesh hierarchy, using amg");
+    }
+    AMG hierarchy;
+    hierarchy.setup(A);
+    return mg_solve(A, b, x, ws, hierarchy, opts);
+  }
+  // Boundary rows and convection make our systems non-symmetric, which
+  // rules out CG, and GMRES converges far faster than Gauss-Seidel.
+  if (!is_solver(method)) {
+    log::warning("Unknown solver \"%s\", using gmres", method.c_str());
+  }
+  return gmres(A, b, x, ws, opts, M);
 }
@@ -1,17 +1,148 @@
 #ifndef ARTA_LINALG_SOLVER_HPP_
 #define ARTA_LINALG_SOLVER_HPP_
 
+#include <string>
+#include <vector>
+
+#include "coloring.hpp"
 #include "matrix.hpp"
+#include "operator.hpp"
 #include "vector.hpp"
+#include "workspace.hpp"
+
+// Default relative residual tolerance of the iterative solvers.
+#define ARTA_SOLVER_TOL 1e-10
+// Default number of sweeps between residual checks of the stationary
+// solvers.
+#define ARTA_SOLVER_CHECK 5
+// Default restart length of GMRES.
+#define ARTA_GMRES_RESTART 30
+// Default iteration cap of the iterative solvers.
+#define ARTA_SOLVER_MAX_ITERS 1000
 
 namespace arta {
 namespace linalg {
   bool diag_dominant(const Matrix& A);
   Vector gauss_seidel(const Matrix& A, const Vector& b,
                       const unsigned& n = 100);
-  Vector conjugate_gradient(const Matrix& A, const Vector& b,
+  Vector conjugate_gradient(const Operator& A, const Vector& b,
                             const unsigned& n = 100);
-  Vector solve(const Matrix& A, const Vector& b, const unsigned& n = 100);
+  Vector gmres(const Operator& A, const Vector& b, const unsigned& n = 100);
+  Vector bicgstab(const Operator& A, const Vector& b,
+                  const unsigned& n = 100);
+  Vector solve(const Matrix& A, const Vector& b, const unsigned& n = 100,
+               const std::string& method = "", const Operator* M = nullptr);
+
+  // How an iterative solve runs and when it stops: once
+  // ||b - A x|| <= max(rtol ||b||, atol), or after max_iters iterations.
+  struct SolverOptions {
+    // See solve and make_preconditioner. precond is only built by solve
+    // when it is not given a preconditioner.
+    std::string method, precond;
+    double rtol = ARTA_SOLVER_TOL;
+    double atol = 0.0;
+    unsigned max_iters = ARTA_SOLVER_MAX_ITERS;
+    // Sweeps between residual checks of the stationary solvers.
+    unsigned check = ARTA_SOLVER_CHECK;
+    unsigned restart = ARTA_GMRES_RESTART;
+    // Keep the residual norm of every checked iteration in the result.
+    bool history = false;
+    // Start from the x passed in, when it has the size of b, rather than
+    // from zero. A close guess, such as the previous time step, saves
+    // iterations.
+    bool guess = false;
+    // Solve in single precision, refined in double until the tolerance is
+    // met (see mixed.hpp).
+    bool mixed = false;
+  };
+
+  // Outcome of a solve. GMRES reports the residual estimate of its Arnoldi
+  // process between restarts, every other solver the true residual norm.
+  struct SolverResult {
+    // Starts a solve of a right hand side of norm norm_b against opts,
+    // clearing the result.
+    void start(const double& norm_b, const SolverOptions& opts);
+    // Records the residual norm after it iterations, replacing the last
+    // entry of the history if it was for the same iteration. Returns true
+    // once the tolerance is met.
+    bool update(const unsigned& it, const double& res);
+
+    unsigned iterations = 0;
+    double residual = 0.0, tolerance = 0.0;
+    bool converged = false;
+    // Whether update() keeps the history, from SolverOptions::history.
+    bool record = false;
+    std::vector<double> history;
+  };
+
+  // In place variants writing the solution to x, which is resized to b if
+  // needed. Iterations start from zero, or from x with opts.guess (the
+  // direct solve ignores it), and take their scratch vectors from
+  // ws, so repeated solves of one size do not allocate unless a history is
+  // kept. The Krylov methods accept a preconditioner M, whose apply(x, y)
+  // forms y = M^-1 x (see precond.hpp).
+
+  // Stationary CSR sweeps: Gauss-Seidel, SOR with relaxation omega, and
+  // SSOR, whose iterations are a forward and a backward SOR sweep. The
+  // residual is only computed every opts.check sweeps.
+  SolverResult gauss_seidel(const Matrix& A, const Vector& b, Vector& x,
+                            Workspace& ws,
+                            const SolverOptions& opts = SolverOptions());
+  SolverResult sor(const Matrix& A, const Vector& b, Vector& x, Workspace& ws,
+                   const double& omega,
+                   const SolverOptions& opts = SolverOptions());
+  SolverResult ssor(const Matrix& A, const Vector& b, Vector& x,
+                    Workspace& ws, const double& omega,
+                    const SolverOptions& opts = SolverOptions());
+  // The same sweeps color by color, each color in parallel (see
+  // coloring.hpp). They converge like the serial sweeps in the order of
+  // the coloring.
+  SolverResult gauss_seidel(const Matrix& A, const Vector& b, Vector& x,
+                            Workspace& ws, const Coloring& colors,
+                            const SolverOptions& opts = SolverOptions());
+  SolverResult ssor(const Matrix& A, const Vector& b, Vector& x,
+                    Workspace& ws, const Coloring& colors,
+                    const double& omega,
+                    const SolverOptions& opts = SolverOptions());
+  // The Krylov solvers are instantiated for double and float, the latter
+  // serving the inner solves of mixed precision refinement (see mixed.hpp).
+
+  // Conjugate gradient for symmetric positive definite A (and M).
+  template <typename _T>
+  SolverResult conjugate_gradient(const BasicOperator<_T>& A,
+                                  const BasicVector<_T>& b,
+                                  BasicVector<_T>& x, BasicWorkspace<_T>& ws,
+                                  const SolverOptions& opts = SolverOptions(),
+                                  const BasicOperator<_T>* M = nullptr);
+  // Restarted GMRES(opts.restart) with modified Gram-Schmidt Arnoldi and
+  // Givens rotations, for general non-singular A, right preconditioned by M.
+  template <typename _T>
+  SolverResult gmres(const BasicOperator<_T>& A, const BasicVector<_T>& b,
+                     BasicVector<_T>& x, BasicWorkspace<_T>& ws,
+                     const SolverOptions& opts = SolverOptions(),
+                     const BasicOperator<_T>* M = nullptr);
+  // BiCGSTAB, for general A in a fixed number of vectors (five, seven when
+  // preconditioned), right preconditioned by M.
+  template <typename _T>
+  SolverResult bicgstab(const BasicOperator<_T>& A, const BasicVector<_T>& b,
+                        BasicVector<_T>& x, BasicWorkspace<_T>& ws,
+                        const SolverOptions& opts = SolverOptions(),
+                        const BasicOperator<_T>* M = nullptr);
+
+  // Solver selected by opts.method: "gmres" (the default, also for ""),
+  // "bicgstab", "cg", "gs", "mcgs" (multicolor Gauss-Seidel), "amg", "gmg"
+  // or "direct". Unknown names are reported and fall back to gmres.
+  // Without M, opts.precond is built for this solve. M is ignored by gs,
+  // mcgs sweeps by its coloring if it is an SSOR of A and colors A
+  // otherwise, amg and gmg cycle it if it is a Multigrid built from A, amg
+  // building one otherwise, and direct solves with it if it is a Direct
+  // factorization of A, factoring A otherwise. With opts.mixed, method
+  // and precond instead make the inner solve of mixed_solve, reusing M if
+  // it is a MixedPrecision of A.
+  SolverResult solve(const Matrix& A, const Vector& b, Vector& x,
+                     Workspace& ws, const SolverOptions& opts,
+                     const Operator* M = nullptr);
+  bool is_solver(const std::string& method);
 }  // namespace linalg
 }  // namespace arta
 
@@ -0,0 +1,116 @@
+#include "sparse.hpp"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "matrix.hpp"
+#include "parallel.hpp"
+#include "vector.hpp"
+
+arta::linalg::SparseMatrix::SparseMatrix() : rows(0), cols(0), row_ptr(1, 0) {}
+arta::linalg::SparseMatrix::SparseMatrix(unsigned long rows, unsigned long cols)
+    : rows(rows), cols(cols), row_ptr(rows + 1, 0) {}
+arta::linalg::SparseMatrix::SparseMatrix(const Matrix& mat)
+    : rows(mat.size()),
+      cols(mat.size()),
+      row_ptr(*mat.get_row_ptr()),
+      col_ind(*mat.get_col_ind()),
+      vals(*mat.get_vals()) {}
+
+arta::linalg::Matrix arta::linalg::square(SparseMatrix&& mat) {
+  return Matrix(mat.rows, std::move(mat.row_ptr), std::move(mat.col_ind),
+                std::move(mat.vals));
+}
+
+arta::linalg::SparseMatrix arta::linalg::transpose(const SparseMatrix& A) {
+  SparseMatrix T(A.cols, A.rows);
+  for (unsigned long k = 0; k < A.count(); ++k) {
+    T.row_ptr[A.col_ind[k] + 1]++;
+  }
+  for (unsigned long r = 0; r < T.rows; ++r) {
+    T.row_ptr[r + 1] += T.row_ptr[r];
+  }
+  T.col_ind.resize(A.count());
+  T.vals.resize(A.count());
+  std::vector<unsigned long> pos(T.row_ptr.begin(), T.row_ptr.end() - 1);
+  // Rows of A are visited in order, so every row of T comes out sorted.
+  for (unsigned long r = 0; r < A.rows; ++r) {
+    for (unsigned long k = A.row_ptr[r]; k < A.row_ptr[r + 1]; ++k) {
+      unsigned long p = pos[A.col_ind[k]]++;
+      T.col_ind[p] = r;
+      T.vals[p] = A.vals[k];
+    }
+  }
+  return T;
+}
+
+arta::linalg::SparseMatrix arta::linalg::spgemm(const SparseMatrix& A,
+                                                const SparseMatrix& B) {
+  SparseMatrix C(A.rows, B.cols);
+  // Rows are numbered below A.rows, so that marks a column as unseen.
+  const unsigned long none = A.rows;
+  std::vector<unsigned long> mark(B.cols, none);
+  for (unsigned long r = 0; r < A.rows; ++r) {
+    unsigned long len = 0;
+    for (unsigned long k = A.row_ptr[r]; k < A.row_ptr[r + 1]; ++k) {
+      unsigned long m = A.col_ind[k];
+      for (unsigned long kk = B.row_ptr[m]; kk < B.row_ptr[m + 1]; ++kk) {
+        if (mark[B.col_ind[kk]] != r) {
+          mark[B.col_ind[kk]] = r;
+          len++;
+        }
+      }
+    }
+    C.row_ptr[r + 1] = C.row_ptr[r] + len;
+  }
+  C.col_ind.resize(C.row_ptr[A.rows]);
+  C.vals.resize(C.row_ptr[A.rows]);
+  std::vector<double> acc(B.cols, 0.0);
+  std::fill(mark.begin(), mark.end(), none);
+  for (unsigned long r = 0; r < A.rows; ++r) {
+    unsigned long* cols = C.col_ind.data() + C.row_ptr[r];
+    unsigned long len = 0;
+    for (unsigned long k = A.row_ptr[r]; k < A.row_ptr[r + 1]; ++k) {
+      unsigned long m = A.col_ind[k];
+      for (unsigned long kk = B.row_ptr[m]; kk < B.row_ptr[m + 1]; ++kk) {
+        unsigned long c = B.col_ind[kk];
+        if (mark[c] != r) {
+          mark[c] = r;
+          cols[len++] = c;
+        }
+        acc[c] += A.vals[k] * B.vals[kk];
+      }
+    }
+    std::sort(cols, cols + len);
+    for (unsigned long i = 0; i < len; ++i) {
+      C.vals[C.row_ptr[r] + i] = acc[cols[i]];
+      acc[cols[i]] = 0.0;
+    }
+  }
+  return C;
+}
+
+arta::linalg::Matrix arta::linalg::galerkin(const SparseMatrix& P,
+                                            const SparseMatrix& R,
+                                            const Matrix& A) {
+  return square(spgemm(R, spgemm(SparseMatrix(A), P)));
+}
+
+void arta::linalg::multiply(const SparseMatrix& A, const Vector& x,
+                            Vector& y) {
+  const unsigned long* row_ptr = A.row_ptr.data();
+  const unsigned long* col_ind = A.col_ind.data();
+  const double* vals = A.vals.data();
+  const double* xv = x.get_vals()->data();
+  double* yv = y.get_vals()->data();
+  parallel_for(0, A.rows, [=](unsigned long begin, unsigned long end) {
+    for (unsigned long r = begin; r < end; ++r) {
+      double sum = 0.0;
+      for (unsigned long k = row_ptr[r]; k < row_ptr[r + 1]; ++k) {
+        sum += vals[k] * xv[col_ind[k]];
+      }
+      yv[r] = sum;
+    }
+  });
+}
@@ -0,0 +1,42 @@
+#ifndef ARTA_LINALG_SPARSE_HPP_
+#define ARTA_LINALG_SPARSE_HPP_
+
+#include <vector>
+
+#include "matrix.hpp"
+#include "vector.hpp"
+
+namespace arta {
+namespace linalg {
+  // Rectangular CSR matrix with sorted columns, used for the transfer
+  // operators of multigrid and the products forming its coarse levels.
+  struct SparseMatrix {
+    SparseMatrix();
+    SparseMatrix(unsigned long rows, unsigned long cols);
+    explicit SparseMatrix(const Matrix& mat);
+
+    inline unsigned long count() const noexcept { return vals.size(); }
+
+    unsigned long rows, cols;
+    std::vector<unsigned long> row_ptr, col_ind;
+    std::vector<double> vals;
+  };
+
+  // Moves a square SparseMatrix into a Matrix.
+  Matrix square(SparseMatrix&& mat);
+
+  SparseMatrix transpose(const SparseMatrix& A);
+  // C = A B by Gustavson's row by row algorithm, a symbolic pass sizing C
+  // followed by a numeric pass, both linear in the number of products.
+  SparseMatrix spgemm(const SparseMatrix& A, const SparseMatrix& B);
+  // R A P, the Galerkin product forming a coarse operator, with R = P^T.
+  Matrix galerkin(const SparseMatrix& P, const SparseMatrix& R,
+                  const Matrix& A);
+
+  // y = A x split across the linalg thread pool, y must have A.rows
+  // entries.
+  void multiply(const SparseMatrix& A, const Vector& x, Vector& y);
+}  // namespace linalg
+}  // namespace arta
+
+#endif  // ARTA_LINALG_SPARSE_HPP_
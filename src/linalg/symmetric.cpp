@@ -0,0 +1,213 @@
+#include "symmetric.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "matrix.hpp"
+#include "parallel.hpp"
+#include "vector.hpp"
+
+namespace {
+// Rows [begin, end) of y = A x. Contributions to rows below end are added
+// to y directly, the rest go to spill[c - end].
+template <typename _T, typename _I>
+void sym_block(unsigned long begin, unsigned long end, const _I* row_ptr,
+               const _I* col_ind, const _T* vals, const _T* xv, _T* yv,
+               _T* spill) {
+  for (unsigned long r = begin; r < end; ++r) {
+    _T sum = 0.0, xr = xv[r];
+    for (_I k = row_ptr[r]; k < row_ptr[r + 1]; ++k) {
+      unsigned long c = col_ind[k];
+      sum += vals[k] * xv[c];
+      if (c == r) {
+        continue;
+      } else if (c < end) {
+        yv[c] += vals[k] * xr;
+      } else {
+        spill[c - end] += vals[k] * xr;
+      }
+    }
+    yv[r] += sum;
+  }
+}
+}  // namespace
+
+template <typename _T, typename _I>
+arta::linalg::BasicSymMatrix<_T, _I>::BasicSymMatrix()
+    : size_(0), blocks_(0) {}
+template <typename _T, typename _I>
+arta::linalg::BasicSymMatrix<_T, _I>::BasicSymMatrix(
+    const BasicMatrix<_T, _I>& mat)
+    : size_(mat.size()), row_ptr_(mat.size() + 1, 0), blocks_(0) {
+  const std::vector<_I>& row_ptr = *mat.get_row_ptr();
+  const std::vector<_I>& col_ind = *mat.get_col_ind();
+  const std::vector<_T>& vals = *mat.get_vals();
+  for (unsigned long r = 0; r < size_; ++r) {
+    for (_I k = row_ptr[r]; k < row_ptr[r + 1]; ++k) {
+      if (col_ind[k] >= r) {
+        row_ptr_[r + 1]++;
+      }
+    }
+    row_ptr_[r + 1] += row_ptr_[r];
+  }
+  col_ind_.reserve(row_ptr_[size_]);
+  vals_.reserve(row_ptr_[size_]);
+  for (unsigned long r = 0; r < size_; ++r) {
+    for (_I k = row_ptr[r]; k < row_ptr[r + 1]; ++k) {
+      if (col_ind[k] >= r) {
+        col_ind_.push_back(col_ind[k]);
+        vals_.push_back(vals[k]);
+      }
+    }
+  }
+}
+
+template <typename _T, typename _I>
+void arta::linalg::BasicSymMatrix<_T, _I>::plan(unsigned blocks) const {
+  blocks_ = blocks;
+  block_ptr_.assign(blocks + 1, 0);
+  spill_ptr_.assign(blocks + 1, 0);
+  for (unsigned b = 0; b < blocks; ++b) {
+    block_ptr_[b + 1] = size_ * (b + 1) / blocks;
+    unsigned long end = block_ptr_[b + 1], hi = end;
+    for (unsigned long k = row_ptr_[block_ptr_[b]]; k < row_ptr_[end]; ++k) {
+      hi = std::max(hi, static_cast<unsigned long>(col_ind_[k]) + 1);
+    }
+    spill_ptr_[b + 1] = spill_ptr_[b] + hi - end;
+  }
+  scratch_.assign(spill_ptr_[blocks], 0.0);
+}
+
+template <typename _T, typename _I>
+void arta::linalg::BasicSymMatrix<_T, _I>::apply(const BasicVector<_T>& x,
+                                                 BasicVector<_T>& y) const {
+  if (y.size() != size_) {
+    y = BasicVector<_T>(size_);
+  }
+  const _I* row_ptr = row_ptr_.data();
+  const _I* col_ind = col_ind_.data();
+  const _T* vals = vals_.data();
+  const _T* xv = x.get_vals()->data();
+  _T* yv = y.get_vals()->data();
+  unsigned threads = get_threads();
+  if (threads == 1 || size_ < 1024) {
+    std::fill(yv, yv + size_, _T(0.0));
+    sym_block(0, size_, row_ptr, col_ind, vals, xv, yv, yv);
+    return;
+  }
+  if (blocks_ != threads) {
+    plan(threads);
+  }
+  _T* scratch = scratch_.data();
+  const unsigned long* block_ptr = block_ptr_.data();
+  const unsigned long* spill_ptr = spill_ptr_.data();
+  parallel_for(
+      0, blocks_,
+      [=](unsigned long begin, unsigned long end) {
+        for (unsigned long b = begin; b < end; ++b) {
+          std::fill(yv + block_ptr[b], yv + block_ptr[b + 1], _T(0.0));
+          std::fill(scratch + spill_ptr[b], scratch + spill_ptr[b + 1],
+                    _T(0.0));
+          sym_block(block_ptr[b], block_ptr[b + 1], row_ptr, col_ind, vals, xv,
+                    yv, scratch + spill_ptr[b]);
+        }
+      },
+      1);
+  unsigned blocks = blocks_;
+  parallel_for(0, size_, [=](unsigned long begin, unsigned long end) {
+    for (unsigned b = 0; b < blocks; ++b) {
+      unsigned long first = block_ptr[b + 1];
+      unsigned long last = first + spill_ptr[b + 1] - spill_ptr[b];
+      const _T* spill = scratch + spill_ptr[b] - first;
+      for (unsigned long i = std::max(begin, first); i < std::min(end, last);
+           ++i) {
+        yv[i] += spill[i];
+      }
+    }
+  });
+}
+
+template <typename _T, typename _I>
+arta::linalg::BasicMatrix<_T, _I> arta::linalg::BasicSymMatrix<_T, _I>::full()
+    const {
+  std::vector<_I> row_ptr(size_ + 1, 0);
+  for (unsigned long r = 0; r < size_; ++r) {
+    for (_I k = row_ptr_[r]; k < row_ptr_[r + 1]; ++k) {
+      row_ptr[r + 1]++;
+      if (col_ind_[k] != r) {
+        row_ptr[col_ind_[k] + 1]++;
+      }
+    }
+  }
+  for (unsigned long r = 0; r < size_; ++r) {
+    row_ptr[r + 1] += row_ptr[r];
+  }
+  std::vector<_I> col_ind(row_ptr[size_]), pos(row_ptr.begin(), row_ptr.end());
+  std::vector<_T> vals(row_ptr[size_]);
+  // Walking rows in order fills each full row with its lower entries first,
+  // in ascending column order, followed by its upper entries.
+  for (unsigned long r = 0; r < size_; ++r) {
+    for (_I k = row_ptr_[r]; k < row_ptr_[r + 1]; ++k) {
+      _I c = col_ind_[k];
+      col_ind[pos[r]] = c;
+      vals[pos[r]++] = vals_[k];
+      if (c != r) {
+        col_ind[pos[c]] = r;
+        vals[pos[c]++] = vals_[k];
+      }
+    }
+  }
+  return BasicMatrix<_T, _I>(size_, std::move(row_ptr), std::move(col_ind),
+                             std::move(vals));
+}
+
+template <typename _T, typename _I>
+bool arta::linalg::symmetric(
+    const BasicMatrix<_T, _I>& A,
+    const typename BasicMatrix<_T, _I>::value_type& tol) {
+  const std::vector<_I>& row_ptr = *A.get_row_ptr();
+  const std::vector<_I>& col_ind = *A.get_col_ind();
+  const std::vector<_T>& vals = *A.get_vals();
+  for (unsigned long r = 0; r < A.size(); ++r) {
+    for (_I k = row_ptr[r]; k < row_ptr[r + 1]; ++k) {
+      if (col_ind[k] > r &&
+          std::fabs(vals[k] - A.at(col_ind[k], r)) > tol) {
+        return false;
+      } else if (col_ind[k] < r && A.at(col_ind[k], r) == 0.0 &&
+                 std::fabs(vals[k]) > tol) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+template <typename _T, typename _I>
+arta::linalg::BasicVector<_T> arta::linalg::operator*(
+    const BasicSymMatrix<_T, _I>& lhs, const BasicVector<_T>& rhs) {
+  BasicVector<_T> res(lhs.size());
+  multiply(lhs, rhs, res);
+  return res;
+}
+template <typename _T, typename _I>
+void arta::linalg::multiply(const BasicSymMatrix<_T, _I>& A,
+                            const BasicVector<_T>& x, BasicVector<_T>& y) {
+  A.apply(x, y);
+}
+
+#define ARTA_INSTANTIATE_SYMMETRIC(_T, _I)                                   \
+  template class arta::linalg::BasicSymMatrix<_T, _I>;                       \
+  template bool arta::linalg::symmetric(                                     \
+      const BasicMatrix<_T, _I>&, const BasicMatrix<_T, _I>::value_type&);   \
+  template arta::linalg::BasicVector<_T> arta::linalg::operator*(            \
+      const BasicSymMatrix<_T, _I>&, const BasicVector<_T>&);                \
+  template void arta::linalg::multiply(const BasicSymMatrix<_T, _I>&,        \
+                                       const BasicVector<_T>&,               \
+                                       BasicVector<_T>&);
+
+ARTA_INSTANTIATE_SYMMETRIC(double, unsigned long)
+ARTA_INSTANTIATE_SYMMETRIC(double, std::uint32_t)
+ARTA_INSTANTIATE_SYMMETRIC(float, unsigned long)
+ARTA_INSTANTIATE_SYMMETRIC(float, std::uint32_t)
@@ -0,0 +1,74 @@
+#ifndef ARTA_LINALG_SYMMETRIC_HPP_
+#define ARTA_LINALG_SYMMETRIC_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "matrix.hpp"
+#include "operator.hpp"
+#include "vector.hpp"
+
+namespace arta {
+namespace linalg {
+  // Symmetric CSR matrix keeping only the upper triangle (diagonal
+  // included). The product reads each off-diagonal entry once and applies
+  // it to both halves.
+  template <typename _T, typename _I>
+  class BasicSymMatrix final : public BasicOperator<_T> {
+   public:
+    typedef _T value_type;
+    typedef _I index_type;
+
+    BasicSymMatrix();
+    // mat is assumed to be symmetric, only its upper triangle is read.
+    explicit BasicSymMatrix(const BasicMatrix<_T, _I>& mat);
+
+    inline unsigned long size() const noexcept override { return size_; }
+    inline unsigned long count() const noexcept { return vals_.size(); }
+
+    // Not safe to call concurrently on the same matrix, the threaded
+    // product keeps its scratch space in the matrix.
+    void apply(const BasicVector<_T>& x, BasicVector<_T>& y) const override;
+
+    // Expands back to a full CSR matrix.
+    BasicMatrix<_T, _I> full() const;
+
+    const std::vector<_I>* get_row_ptr() const { return &row_ptr_; }
+    const std::vector<_I>* get_col_ind() const { return &col_ind_; }
+    const std::vector<_T>* get_vals() const { return &vals_; }
+
+   private:
+    void plan(unsigned blocks) const;
+
+    unsigned long size_;
+    std::vector<_I> row_ptr_, col_ind_;
+    std::vector<_T> vals_;
+
+    // Threaded products split the rows into one block per thread. Updates a
+    // block makes to rows past its end go to its own spill range of
+    // scratch_, which is summed into y afterwards.
+    mutable unsigned blocks_;
+    mutable std::vector<unsigned long> block_ptr_, spill_ptr_;
+    mutable std::vector<_T> scratch_;
+  };
+
+  typedef BasicSymMatrix<double, unsigned long> SymMatrix;
+  typedef BasicSymMatrix<double, std::uint32_t> SymMatrix32;
+  typedef BasicSymMatrix<float, std::uint32_t> SymMatrixf;
+
+  // True if every entry of A matches its transpose to within tol.
+  template <typename _T, typename _I>
+  bool symmetric(const BasicMatrix<_T, _I>& A,
+                 const typename BasicMatrix<_T, _I>::value_type& tol = 0.0);
+
+  template <typename _T, typename _I>
+  BasicVector<_T> operator*(const BasicSymMatrix<_T, _I>& lhs,
+                            const BasicVector<_T>& rhs);
+  // y = A x, y is resized to A.size() if needed.
+  template <typename _T, typename _I>
+  void multiply(const BasicSymMatrix<_T, _I>& A, const BasicVector<_T>& x,
+                BasicVector<_T>& y);
+}  // namespace linalg
+}  // namespace arta
+
+#endif  // ARTA_LINALG_SYMMETRIC_HPP_
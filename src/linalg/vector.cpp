@@ -3,21 +3,30 @@
 #include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <string>
 #include <vector>
 
 #include "../logger.hpp"
 #include "../print.hpp"
+#include "binary.hpp"
 
-arta::linalg::Vector::Vector() : vals_() {}
-arta::linalg::Vector::Vector(unsigned long n) : vals_(n, 0.0) {}
-arta::linalg::Vector::Vector(unsigned long n, double v) : vals_(n, v) {}
-arta::linalg::Vector::Vector(const Vector& copy) : vals_(copy.vals_) {}
+template <typename _T>
+arta::linalg::BasicVector<_T>::BasicVector() : vals_() {}
+template <typename _T>
+arta::linalg::BasicVector<_T>::BasicVector(unsigned long n) : vals_(n, 0.0) {}
+template <typename _T>
+arta::linalg::BasicVector<_T>::BasicVector(unsigned long n, _T v)
+    : vals_(n, v) {}
+template <typename _T>
+arta::linalg::BasicVector<_T>::BasicVector(const BasicVector& copy)
+    : vals_(copy.vals_) {}
 
-std::string arta::linalg::Vector::dump() const {
+template <typename _T>
+std::string arta::linalg::BasicVector<_T>::dump() const {
   std::string str;
   for (int i = 0; i < vals_.size(); ++i) {
-    str += arta::fmt_val(vals_[i]);
+    str += arta::fmt_val(static_cast<double>(vals_[i]));
     if (i < vals_.size() - 1) {
       str += " ";
     }
@@ -25,82 +34,57 @@ std::string arta::linalg::Vector::dump() const {
   return str;
 }
 
+template <typename _T>
 void arta::linalg::save_vec_to_file(const std::string& file_name,
-                                    const Vector& vec) {
+                                    const BasicVector<_T>& vec) {
+  FileHeader header = {};
+  std::memcpy(header.magic, "ARTAVEC", 8);
+  header.scalar_size = sizeof(_T);
+  header.size = vec.size();
+  header.count = vec.size();
+  write_binary(file_name, header,
+               {{vec.get_vals()->data(), vec.size() * sizeof(_T)}});
+}
+template <typename _T>
+arta::linalg::BasicVector<_T> arta::linalg::load_vec_from_file(
+    const std::string& file_name) {
+  MappedFile file(file_name);
+  FileHeader header;
+  std::vector<unsigned long> offsets;
+  if (!read_header(file, "ARTAVEC", sizeof(_T), 0, &header) ||
+      !locate_arrays(file, header, {header.size * sizeof(_T)}, &offsets)) {
+    log::warning("Failed to load vector \"%s\"", file_name.c_str());
+    return BasicVector<_T>();
+  }
+  BasicVector<_T> vec(header.size);
+  std::memcpy(vec.get_vals()->data(), file.data() + offsets[0],
+              header.size * sizeof(_T));
+  return vec;
+}
+template <typename _T>
+void arta::linalg::export_vec_to_text(const std::string& file_name,
+                                      const BasicVector<_T>& vec) {
   FILE* out = fopen(file_name.c_str(), "w");
   if (!out) {
     log::warning("Failed to open file \"%s\"", file_name.c_str());
     return;
   }
   fprintf(out, "%lu\n", vec.size());
-  const std::vector<double>* vals = vec.get_vals();
+  const typename BasicVector<_T>::storage_type* vals = vec.get_vals();
   for (unsigned long i = 0; i < vals->size(); ++i) {
-    fprintf(out, "%0.10lf ", vals->at(i));
+    fprintf(out, "%0.10lf ", static_cast<double>(vals->at(i)));
   }
   fclose(out);
 }
-arta::linalg::Vector arta::linalg::load_vec_from_file(
-    const std::string& file_name) {
-  FILE* src = fopen(file_name.c_str(), "r");
-  if (!src) {
-    log::warning("Failed to open file \"%s\"", file_name.c_str());
-    return Vector();
-  }
-  unsigned long size;
-  fscanf(src, "%lu", &size);
-  Vector vec(size);
-  for (unsigned long i = 0; i < size; ++i) {
-    fscanf(src, "%lf", &vec[i]);
-  }
-  fclose(src);
-  return vec;
-}
-
-arta::linalg::Vector arta::linalg::operator+(const Vector& lhs,
-                                             const Vector& rhs) {
-  Vector vec(std::min(lhs.size(), rhs.size()));
-  for (unsigned long i = 0; i < vec.size(); ++i) {
-    vec.set(i, lhs.at(i) + rhs.at(i));
-  }
-  return vec;
-}
-arta::linalg::Vector arta::linalg::operator-(const Vector& lhs,
-                                             const Vector& rhs) {
-  Vector vec(std::min(lhs.size(), rhs.size()));
-  for (unsigned long i = 0; i < vec.size(); ++i) {
-    vec.set(i, lhs.at(i) - rhs.at(i));
-  }
-  return vec;
-}
-arta::linalg::Vector arta::linalg::operator*(const Vector& lhs,
-                                             const double& rhs) {
-  Vector vec(lhs.size());
-  for (unsigned long i = 0; i < vec.size(); ++i) {
-    vec.set(i, lhs.at(i) * rhs);
-  }
-  return vec;
-}
-arta::linalg::Vector arta::linalg::operator*(const double& lhs,
-                                             const Vector& rhs) {
-  Vector vec(rhs.size());
-  for (unsigned long i = 0; i < vec.size(); ++i) {
-    vec.set(i, rhs.at(i) * lhs);
-  }
-  return vec;
-}
 
-double arta::linalg::dot(const Vector& lhs, const Vector& rhs) {
-  double val = 0.0;
-  for (unsigned long i = 0; i < lhs.size() && i < rhs.size(); ++i) {
-    val += (lhs.at(i) * rhs.at(i));
-  }
-  return val;
-}
+#define ARTA_INSTANTIATE_VECTOR(_T)                                          \
+  template class arta::linalg::BasicVector<_T>;                              \
+  template void arta::linalg::save_vec_to_file(const std::string&,           \
+                                               const BasicVector<_T>&);      \
+  template arta::linalg::BasicVector<_T> arta::linalg::load_vec_from_file(   \
+      const std::string&);                                                   \
+  template void arta::linalg::export_vec_to_text(const std::string&,         \
+                                                 const BasicVector<_T>&);
 
-double arta::linalg::norm(const Vector& lhs) {
-  double val = 0.0;
-  for (unsigned long i = 0; i < lhs.size(); ++i) {
-    val += (lhs.at(i) * lhs.at(i));
-  }
-  return std::sqrt(val);
-}
+ARTA_INSTANTIATE_VECTOR(double)
+ARTA_INSTANTIATE_VECTOR(float)
@@ -1,60 +1,234 @@
 #ifndef ARTA_MATH_VECTOR_HPP_
 #define ARTA_MATH_VECTOR_HPP_
 
+#include <algorithm>
+#include <cmath>
 #include <string>
+#include <type_traits>
 #include <vector>
 
+#include "aligned.hpp"
+#include "blas.hpp"
+
+// Element access and the BLAS-1 kernels check indices and sizes unless
+// NDEBUG is defined.
+#if !defined(NDEBUG) && !defined(ARTA_CHECK_BOUNDS)
+#define ARTA_CHECK_BOUNDS
+#endif
+
 namespace arta {
 namespace linalg {
-  class Vector {
+  // Base of lazily evaluated vector expressions. Sums, differences and
+  // scalings of vectors build a tree of expression nodes, which is only
+  // evaluated element by element, in a single loop, when it is assigned to
+  // a BasicVector. Nodes hold references to their vector operands, so an
+  // expression must not outlive the statement it was built in.
+  template <typename _E>
+  class VectorExpr {
+   public:
+    inline const _E& self() const { return static_cast<const _E&>(*this); }
+    inline unsigned long size() const { return self().size(); }
+  };
+
+  template <typename _T>
+  class BasicVector : public VectorExpr<BasicVector<_T>> {
    public:
-    Vector();
-    explicit Vector(unsigned long n);
-    Vector(unsigned long n, double v);
-    Vector(const Vector& copy);
+    typedef _T value_type;
+    typedef std::vector<_T, AlignedAllocator<_T>> storage_type;
+
+    BasicVector();
+    explicit BasicVector(unsigned long n);
+    BasicVector(unsigned long n, _T v);
+    BasicVector(const BasicVector& copy);
+    BasicVector(BasicVector&& other) noexcept = default;
+    template <typename _U>
+    explicit BasicVector(const BasicVector<_U>& copy)
+        : vals_(copy.get_vals()->begin(), copy.get_vals()->end()) {}
+    template <typename _E,
+              typename = typename std::enable_if<
+                  std::is_same<typename _E::value_type, _T>::value>::type>
+    BasicVector(const VectorExpr<_E>& expr) : vals_(expr.size()) {
+      assign(expr.self());
+    }
+
+    BasicVector& operator=(const BasicVector& copy) = default;
+    BasicVector& operator=(BasicVector&& other) noexcept = default;
+    template <typename _E>
+    inline BasicVector& operator=(const VectorExpr<_E>& expr) {
+      // Every element only depends on the same element of the operands, so
+      // evaluating in place is safe even if this vector appears in expr.
+      if (vals_.size() != expr.size()) {
+        vals_.resize(expr.size());
+      }
+      assign(expr.self());
+      return *this;
+    }
 
     inline unsigned long size() const noexcept { return vals_.size(); }
-    double& operator[](unsigned long i) { return vals_.at(i); }
-    double operator[](unsigned long i) const { return vals_.at(i); }
-    double& operator()(unsigned long i) { return vals_.at(i); }
-    double operator()(unsigned long i) const { return vals_.at(i); }
-    double at(unsigned long i) const { return vals_.at(i); }
-    void set(unsigned long i, const double& val) { vals_.at(i) = val; }
+    _T& operator[](unsigned long i) { return elem(i); }
+    _T operator[](unsigned long i) const { return elem(i); }
+    _T& operator()(unsigned long i) { return elem(i); }
+    _T operator()(unsigned long i) const { return elem(i); }
+    _T at(unsigned long i) const { return elem(i); }
+    void set(unsigned long i, const _T& val) { elem(i) = val; }
 
     void clear() { vals_.clear(); }
 
     std::string dump() const;
 
-    std::vector<double>* get_vals() { return &vals_; }
-    const std::vector<double>* get_vals() const { return &vals_; }
+    storage_type* get_vals() { return &vals_; }
+    const storage_type* get_vals() const { return &vals_; }
 
-    inline Vector& operator+=(const Vector& rhs) {
-      for (unsigned i = 0; i < vals_.size() && i < rhs.size(); ++i) {
-        vals_[i] += rhs.at(i);
+    // Unchecked element access used when evaluating expressions.
+    inline _T eval(unsigned long i) const { return vals_[i]; }
+
+    template <typename _E>
+    inline BasicVector& operator+=(const VectorExpr<_E>& rhs) {
+      const _E& expr = rhs.self();
+      unsigned long n = std::min(vals_.size(), expr.size());
+      for (unsigned long i = 0; i < n; ++i) {
+        vals_[i] += expr.eval(i);
       }
       return *this;
     }
-    inline Vector& operator-=(const Vector& rhs) {
-      for (unsigned i = 0; i < vals_.size() && i < rhs.size(); ++i) {
-        vals_[i] -= rhs.at(i);
+    template <typename _E>
+    inline BasicVector& operator-=(const VectorExpr<_E>& rhs) {
+      const _E& expr = rhs.self();
+      unsigned long n = std::min(vals_.size(), expr.size());
+      for (unsigned long i = 0; i < n; ++i) {
+        vals_[i] -= expr.eval(i);
       }
       return *this;
     }
 
    private:
-    std::vector<double> vals_;
+#ifdef ARTA_CHECK_BOUNDS
+    inline _T& elem(unsigned long i) { return vals_.at(i); }
+    inline const _T& elem(unsigned long i) const { return vals_.at(i); }
+#else
+    inline _T& elem(unsigned long i) { return vals_[i]; }
+    inline const _T& elem(unsigned long i) const { return vals_[i]; }
+#endif
+
+    template <typename _E>
+    inline void assign(const _E& expr) {
+      _T* vals = vals_.data();
+      for (unsigned long i = 0; i < vals_.size(); ++i) {
+        vals[i] = expr.eval(i);
+      }
+    }
+
+    storage_type vals_;
   };
 
-  void save_vec_to_file(const std::string& file_name, const Vector& vec);
-  Vector load_vec_from_file(const std::string& file_name);
+  // Vectors are held by reference inside expressions, other nodes by value.
+  template <typename _E>
+  struct ExprOperand {
+    typedef const _E type;
+  };
+  template <typename _T>
+  struct ExprOperand<BasicVector<_T>> {
+    typedef const BasicVector<_T>& type;
+  };
 
-  Vector operator+(const Vector& lhs, const Vector& rhs);
-  Vector operator-(const Vector& lhs, const Vector& rhs);
-  Vector operator*(const Vector& lhs, const double& rhs);
-  Vector operator*(const double& lhs, const Vector& rhs);
+  template <typename _L, typename _R>
+  class VectorSum : public VectorExpr<VectorSum<_L, _R>> {
+   public:
+    typedef typename _L::value_type value_type;
+    VectorSum(const _L& lhs, const _R& rhs) : lhs_(lhs), rhs_(rhs) {}
+    inline unsigned long size() const {
+      return std::min(lhs_.size(), rhs_.size());
+    }
+    inline value_type eval(unsigned long i) const {
+      return lhs_.eval(i) + rhs_.eval(i);
+    }
 
-  double dot(const Vector& lhs, const Vector& rhs);
-  double norm(const Vector& lhs);
+   private:
+    typename ExprOperand<_L>::type lhs_;
+    typename ExprOperand<_R>::type rhs_;
+  };
+
+  template <typename _L, typename _R>
+  class VectorDiff : public VectorExpr<VectorDiff<_L, _R>> {
+   public:
+    typedef typename _L::value_type value_type;
+    VectorDiff(const _L& lhs, const _R& rhs) : lhs_(lhs), rhs_(rhs) {}
+    inline unsigned long size() const {
+      return std::min(lhs_.size(), rhs_.size());
+    }
+    inline value_type eval(unsigned long i) const {
+      return lhs_.eval(i) - rhs_.eval(i);
+    }
+
+   private:
+    typename ExprOperand<_L>::type lhs_;
+    typename ExprOperand<_R>::type rhs_;
+  };
+
+  template <typename _E>
+  class VectorScale : public VectorExpr<VectorScale<_E>> {
+   public:
+    typedef typename _E::value_type value_type;
+    VectorScale(const value_type& alpha, const _E& expr)
+        : alpha_(alpha), expr_(expr) {}
+    inline unsigned long size() const { return expr_.size(); }
+    inline value_type eval(unsigned long i) const {
+      return alpha_ * expr_.eval(i);
+    }
+
+   private:
+    value_type alpha_;
+    typename ExprOperand<_E>::type expr_;
+  };
+
+  typedef BasicVector<double> Vector;
+  typedef BasicVector<float> Vectorf;
+
+  // Binary .vec files, see binary.hpp.
+  template <typename _T>
+  void save_vec_to_file(const std::string& file_name,
+                        const BasicVector<_T>& vec);
+  template <typename _T = double>
+  BasicVector<_T> load_vec_from_file(const std::string& file_name);
+  template <typename _T>
+  void export_vec_to_text(const std::string& file_name,
+                          const BasicVector<_T>& vec);
+
+  template <typename _L, typename _R>
+  inline VectorSum<_L, _R> operator+(const VectorExpr<_L>& lhs,
+                                     const VectorExpr<_R>& rhs) {
+    return VectorSum<_L, _R>(lhs.self(), rhs.self());
+  }
+  template <typename _L, typename _R>
+  inline VectorDiff<_L, _R> operator-(const VectorExpr<_L>& lhs,
+                                      const VectorExpr<_R>& rhs) {
+    return VectorDiff<_L, _R>(lhs.self(), rhs.self());
+  }
+  template <typename _E>
+  inline VectorScale<_E> operator*(const VectorExpr<_E>& lhs,
+                                   const typename _E::value_type& rhs) {
+    return VectorScale<_E>(rhs, lhs.self());
+  }
+  template <typename _E>
+  inline VectorScale<_E> operator*(const typename _E::value_type& lhs,
+                                   const VectorExpr<_E>& rhs) {
+    return VectorScale<_E>(lhs, rhs.self());
+  }
+
+  template <typename _L, typename _R>
+  inline typename _L::value_type dot(const VectorExpr<_L>& lhs,
+                                     const VectorExpr<_R>& rhs) {
+    typename _L::value_type val = 0.0;
+    unsigned long n = std::min(lhs.size(), rhs.size());
+    for (unsigned long i = 0; i < n; ++i) {
+      val += lhs.self().eval(i) * rhs.self().eval(i);
+    }
+    return val;
+  }
+  template <typename _E>
+  inline typename _E::value_type norm(const VectorExpr<_E>& lhs) {
+    return std::sqrt(dot(lhs, lhs));
+  }
 }  // namespace linalg
 }  // namespace arta
 
@@ -0,0 +1,32 @@
+#include "workspace.hpp"
+
+#include <memory>
+#include <vector>
+
+#include "vector.hpp"
+
+template <typename _T>
+arta::linalg::BasicWorkspace<_T>::BasicWorkspace() : size_(0), used_(0) {}
+template <typename _T>
+arta::linalg::BasicWorkspace<_T>::BasicWorkspace(unsigned long n)
+    : size_(n), used_(0) {}
+
+template <typename _T>
+void arta::linalg::BasicWorkspace<_T>::resize(unsigned long n) {
+  if (n != size_) {
+    size_ = n;
+    used_ = 0;
+    pool_.clear();
+  }
+}
+
+template <typename _T>
+arta::linalg::BasicVector<_T>& arta::linalg::BasicWorkspace<_T>::acquire() {
+  if (used_ == pool_.size()) {
+    pool_.emplace_back(new BasicVector<_T>(size_));
+  }
+  return *pool_[used_++];
+}
+
+template class arta::linalg::BasicWorkspace<double>;
+template class arta::linalg::BasicWorkspace<float>;
@@ -0,0 +1,48 @@
+#ifndef ARTA_LINALG_WORKSPACE_HPP_
+#define ARTA_LINALG_WORKSPACE_HPP_
+
+#include <memory>
+#include <vector>
+
+#include "vector.hpp"
+
+namespace arta {
+namespace linalg {
+  // Pool of scratch vectors of one length. acquire() hands out a vector
+  // that stays reserved until reset(), after which the same vectors are
+  // handed out again, so a loop that resets once per iteration only
+  // allocates during its first iteration.
+  template <typename _T>
+  class BasicWorkspace {
+   public:
+    BasicWorkspace();
+    explicit BasicWorkspace(unsigned long n);
+    BasicWorkspace(const BasicWorkspace&) = delete;
+    BasicWorkspace& operator=(const BasicWorkspace&) = delete;
+
+    inline unsigned long size() const noexcept { return size_; }
+    // Number of vectors currently handed out, and held by the pool.
+    inline unsigned long used() const noexcept { return used_; }
+    inline unsigned long pooled() const noexcept { return pool_.size(); }
+
+    // Changes the length of the vectors, dropping the pool if it differs.
+    void resize(unsigned long n);
+
+    // Returns a vector of length size(), its contents are left over from
+    // its previous use.
+    BasicVector<_T>& acquire();
+    // Returns every vector to the pool, keeping their storage.
+    inline void reset() noexcept { used_ = 0; }
+
+   private:
+    unsigned long size_, used_;
+    // Vectors are held by pointer so references stay valid as it grows.
+    std::vector<std::unique_ptr<BasicVector<_T>>> pool_;
+  };
+
+  typedef BasicWorkspace<double> Workspace;
+  typedef BasicWorkspace<float> Workspacef;
+}  // namespace linalg
+}  // namespace arta
+
+#endif  // ARTA_LINALG_WORKSPACE_HPP_
@@ -13,11 +13,37 @@ int main(int argc, char* argv[]) {
   parser.add_option('m', "mesh", "", "Mesh file to load");
   parser.add_option('a', "mesh-area", "-1", "Mesh maximum triangle area");
   parser.add_option('q', "mesh-angle", "-1", "Mesh minimum triangle angle");
+  parser.add_option('o', "order", "",
+                    "Mesh ordering to apply (none, rcm or hilbert)");
+  parser.add_option('l', "solver", "",
+                    "Linear solver (gmres, bicgstab, cg, gs, mcgs, amg, gmg "
+                    "or direct)");
+  parser.add_option('p', "precond", "",
+                    "Preconditioner (none, jacobi, ilu0, ic0, ssor, amg, gmg "
+                    "or direct)");
+  parser.add_option('e', "refine", "0",
+                    "Uniform refinements of the mesh, for gmg");
+  parser.add_option("rtol", "", "Solver tolerance relative to |b|");
+  parser.add_option("atol", "", "Solver absolute residual tolerance");
+  parser.add_option("max-iters", "", "Solver iteration limit");
+  parser.add_option("check", "",
+                    "Iterations between solver convergence checks");
+  parser.add_flag("history", "Saves the solver residual history");
+  parser.add_flag("mixed",
+                  "Solves in single precision with double refinement");
+  parser.add_option("guess", "",
+                    "Time step initial guess (zero, previous or linear)");
   parser.add_option('c', "cmap", "parula", "Plot color map basis");
   parser.add_option('b', "bg", "0xFFFFFF", "Plot background color");
   parser.add_option('f', "func", "", "Plot additional function");
   parser.add_flag('n', "no-save", "Disables tool file saving");
+  parser.add_flag('x', "text", "Also exports saved matrices/vectors as text");
+  parser.add_option('j', "threads", "0",
+                    "Number of linear algebra threads (0 for all cores)");
   auto args = parser.parse_args(argc, argv);
+  if (args.geti("threads") > 0) {
+    arta::linalg::set_threads(args.geti("threads"));
+  }
   std::vector<double> times;
   if (!args.flags["verbose"]) {
     arta::log::Console()->set_activation(arta::log::FATAL | arta::log::ERROR |
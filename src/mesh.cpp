@@ -1,15 +1,98 @@
 #include "mesh.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdlib>
 #include <string>
+#include <vector>
 
 #include <sys/stat.h>
 #include <sys/types.h>
 
+#include "linalg.hpp"
 #include "logger.hpp"
 #include "script.hpp"
 
+namespace {
+// Index along a Hilbert curve filling a 2^16 by 2^16 grid.
+unsigned long hilbert_index(unsigned long x, unsigned long y) {
+  const unsigned long n = 1ul << 16;
+  unsigned long d = 0;
+  for (unsigned long s = n / 2; s > 0; s /= 2) {
+    unsigned long rx = (x & s) > 0, ry = (y & s) > 0;
+    d += s * s * ((3 * rx) ^ ry);
+    if (ry == 0) {
+      if (rx == 1) {
+        x = n - 1 - x;
+        y = n - 1 - y;
+      }
+      std::swap(x, y);
+    }
+  }
+  return d;
+}
+
+// Sorts the indices of pts along a Hilbert curve through their bounding box.
+std::vector<unsigned long> hilbert_sort(
+    const std::vector<arta::linalg::Pair<double>>& pts) {
+  std::vector<unsigned long> order(pts.size());
+  if (pts.empty()) {
+    return order;
+  }
+  double x0 = pts[0].x, y0 = pts[0].y, x1 = x0, y1 = y0;
+  for (auto& pt : pts) {
+    x0 = std::min(x0, pt.x);
+    y0 = std::min(y0, pt.y);
+    x1 = std::max(x1, pt.x);
+    y1 = std::max(y1, pt.y);
+  }
+  double scale = 65535.0 / std::max(std::max(x1 - x0, y1 - y0), 1e-300);
+  std::vector<unsigned long> key(pts.size());
+  for (unsigned long i = 0; i < pts.size(); ++i) {
+    order[i] = i;
+    key[i] = hilbert_index(
+        static_cast<unsigned long>((pts[i].x - x0) * scale),
+        static_cast<unsigned long>((pts[i].y - y0) * scale));
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [&](unsigned long a, unsigned long b) {
+                     return key[a] < key[b];
+                   });
+  return order;
+}
+
+// Breadth first search from root over unvisited vertices, returning the
+// vertices in visit order, the index in it where the last level starts and
+// the number of levels.
+std::vector<unsigned long> bfs(unsigned long root,
+                               const std::vector<unsigned long>& row_ptr,
+                               const std::vector<unsigned long>& col_ind,
+                               const std::vector<bool>& visited,
+                               std::vector<unsigned long>& stamp,
+                               unsigned long mark, unsigned long* last,
+                               unsigned long* depth) {
+  std::vector<unsigned long> queue(1, root);
+  stamp[root] = mark;
+  *last = 0;
+  *depth = 1;
+  for (unsigned long head = 0, level_end = 1; head < queue.size(); ++head) {
+    if (head == level_end) {
+      *last = head;
+      level_end = queue.size();
+      ++*depth;
+    }
+    for (unsigned long k = row_ptr[queue[head]]; k < row_ptr[queue[head] + 1];
+         ++k) {
+      if (!visited[col_ind[k]] && stamp[col_ind[k]] != mark) {
+        stamp[col_ind[k]] = mark;
+        queue.push_back(col_ind[k]);
+      }
+    }
+  }
+  return queue;
+}
+}  // namespace
+
 arta::mesh::Mesh::Mesh() {}
 arta::mesh::Mesh::Mesh(const std::string& base_name) {
   FILE* input = fopen((base_name + ".node").c_str(), "r");
@@ -140,6 +223,209 @@ bool arta::mesh::Mesh::is_boundary(const unsigned& e) const {
   return bdry_index[e] != 0;
 }
 
+unsigned long arta::mesh::Mesh::bandwidth() const {
+  unsigned long width = 0;
+  for (auto& t : tri) {
+    for (unsigned i = 0; i < 3; ++i) {
+      width = std::max(width, static_cast<unsigned long>(
+                                  std::abs(t[i] - t[(i + 1) % 3])));
+    }
+  }
+  return width;
+}
+
+std::vector<unsigned long> arta::mesh::Mesh::rcm_order() const {
+  linalg::Pattern graph(pts.size(), tri);
+  const std::vector<unsigned long>& row_ptr = *graph.get_row_ptr();
+  const std::vector<unsigned long>& col_ind = *graph.get_col_ind();
+  auto degree = [&](unsigned long v) { return row_ptr[v + 1] - row_ptr[v]; };
+  std::vector<bool> visited(pts.size(), false);
+  std::vector<unsigned long> order, stamp(pts.size(), 0);
+  order.reserve(pts.size());
+  unsigned long mark = 0, last, depth;
+  for (unsigned long start = 0; start < pts.size(); ++start) {
+    if (visited[start]) {
+      continue;
+    }
+    // Pseudo-peripheral root: restart from the lowest degree vertex of the
+    // deepest level until the level structure stops getting deeper.
+    unsigned long root = start, max_depth = 0;
+    for (unsigned iter = 0; iter < 8; ++iter) {
+      std::vector<unsigned long> levels =
+          bfs(root, row_ptr, col_ind, visited, stamp, ++mark, &last, &depth);
+      unsigned long next = levels[last];
+      for (unsigned long i = last; i < levels.size(); ++i) {
+        if (degree(levels[i]) < degree(next)) {
+          next = levels[i];
+        }
+      }
+      if (iter != 0 && depth <= max_depth) {
+        break;
+      }
+      max_depth = depth;
+      root = next;
+    }
+    unsigned long head = order.size();
+    order.push_back(root);
+    visited[root] = true;
+    std::vector<unsigned long> next;
+    for (; head < order.size(); ++head) {
+      next.clear();
+      for (unsigned long k = row_ptr[order[head]];
+           k < row_ptr[order[head] + 1]; ++k) {
+        if (!visited[col_ind[k]]) {
+          visited[col_ind[k]] = true;
+          next.push_back(col_ind[k]);
+        }
+      }
+      std::stable_sort(next.begin(), next.end(),
+                       [&](unsigned long a, unsigned long b) {
+                         return degree(a) < degree(b);
+                       });
+      order.insert(order.end(), next.begin(), next.end());
+    }
+  }
+  std::reverse(order.begin(), order.end());
+  return order;
+}
+
+std::vector<unsigned long> arta::mesh::Mesh::hilbert_order() const {
+  return hilbert_sort(pts);
+}
+
+std::vector<unsigned long> arta::mesh::Mesh::tri_order() const {
+  std::vector<linalg::Pair<double>> centroids;
+  centroids.reserve(tri.size());
+  for (auto& t : tri) {
+    centroids.push_back({(pts[t[0]].x + pts[t[1]].x + pts[t[2]].x) / 3.0,
+                         (pts[t[0]].y + pts[t[1]].y + pts[t[2]].y) / 3.0});
+  }
+  return hilbert_sort(centroids);
+}
+
+void arta::mesh::Mesh::permute(const std::vector<unsigned long>& vert_order,
+                               const std::vector<unsigned long>& tri_order) {
+  std::vector<long> vert_map(pts.size()), tri_map(tri.size());
+  std::vector<linalg::Pair<double>> new_pts(pts.size());
+  std::vector<unsigned long> new_bdry(bdry_index.size());
+  for (unsigned long i = 0; i < vert_order.size(); ++i) {
+    vert_map[vert_order[i]] = i;
+    new_pts[i] = pts[vert_order[i]];
+    new_bdry[i] = bdry_index[vert_order[i]];
+  }
+  for (unsigned long i = 0; i < tri_order.size(); ++i) {
+    tri_map[tri_order[i]] = i;
+  }
+  std::vector<linalg::Triple<long>> new_tri(tri.size()), new_adj(adj.size());
+  for (unsigned long i = 0; i < tri_order.size(); ++i) {
+    for (unsigned j = 0; j < 3; ++j) {
+      new_tri[i][j] = vert_map[tri[tri_order[i]][j]];
+    }
+  }
+  for (unsigned long i = 0; i < adj.size(); ++i) {
+    for (unsigned j = 0; j < 3; ++j) {
+      long neighbour = adj[tri_order[i]][j];
+      new_adj[i][j] = neighbour == -1 ? -1 : tri_map[neighbour];
+    }
+  }
+  pts.swap(new_pts);
+  bdry_index.swap(new_bdry);
+  tri.swap(new_tri);
+  adj.swap(new_adj);
+}
+
+bool arta::mesh::Mesh::reorder(const std::string& method) {
+  if (method == "rcm") {
+    permute(rcm_order(), tri_order());
+  } else if (method == "hilbert") {
+    permute(hilbert_order(), tri_order());
+  } else {
+    log::warning("Unknown mesh ordering \"%s\"", method.c_str());
+    return false;
+  }
+  return true;
+}
+
+arta::mesh::Mesh arta::mesh::Mesh::refine(linalg::SparseMatrix& P) const {
+  Mesh fine;
+  fine.bounds = bounds;
+  fine.has_holes_ = has_holes_;
+  fine.pts = pts;
+  fine.bdry_index = bdry_index;
+  // Midpoint of every edge, shared with the neighbour across it.
+  std::vector<linalg::Triple<long>> mid(tri.size());
+  std::vector<linalg::Pair<unsigned long>> ends;
+  for (unsigned long t = 0; t < tri.size(); ++t) {
+    for (unsigned i = 0; i < 3; ++i) {
+      long n = adj[t][i];
+      if (n != -1 && static_cast<unsigned long>(n) < t) {
+        for (unsigned j = 0; j < 3; ++j) {
+          if (adj[n][j] == static_cast<long>(t)) {
+            mid[t][i] = mid[n][j];
+          }
+        }
+        continue;
+      }
+      unsigned long a = tri[t][i], b = tri[t][(i + 1) % 3];
+      mid[t][i] = fine.pts.size();
+      fine.pts.push_back(
+          {(pts[a].x + pts[b].x) / 2.0, (pts[a].y + pts[b].y) / 2.0});
+      // A boundary edge between differently marked vertices (a corner)
+      // takes the smaller nonzero marker.
+      unsigned long marker = 0;
+      if (n == -1) {
+        marker = bdry_index[a];
+        if (marker == 0 || (bdry_index[b] != 0 && bdry_index[b] < marker)) {
+          marker = bdry_index[b];
+        }
+      }
+      fine.bdry_index.push_back(marker);
+      ends.push_back({std::min(a, b), std::max(a, b)});
+    }
+  }
+  // Child of the neighbour across edge i of t at vertex v of t.
+  auto child = [&](unsigned long t, unsigned i, long v) -> long {
+    long n = adj[t][i];
+    if (n == -1) return -1;
+    for (unsigned j = 0; j < 3; ++j) {
+      if (tri[n][j] == v) return 4 * n + j;
+    }
+    return -1;
+  };
+  fine.tri.reserve(4 * tri.size());
+  fine.adj.reserve(4 * tri.size());
+  for (unsigned long t = 0; t < tri.size(); ++t) {
+    long v0 = tri[t][0], v1 = tri[t][1], v2 = tri[t][2];
+    long m0 = mid[t][0], m1 = mid[t][1], m2 = mid[t][2];
+    long c = 4 * t;
+    fine.tri.push_back({v0, m0, m2});
+    fine.tri.push_back({m0, v1, m1});
+    fine.tri.push_back({m2, m1, v2});
+    fine.tri.push_back({m0, m1, m2});
+    fine.adj.push_back({child(t, 0, v0), c + 3, child(t, 2, v0)});
+    fine.adj.push_back({child(t, 0, v1), child(t, 1, v1), c + 3});
+    fine.adj.push_back({c + 3, child(t, 1, v2), child(t, 2, v2)});
+    fine.adj.push_back({c + 1, c + 2, c});
+  }
+  unsigned long n = pts.size();
+  P = linalg::SparseMatrix(fine.pts.size(), n);
+  P.col_ind.reserve(n + 2 * ends.size());
+  P.vals.reserve(n + 2 * ends.size());
+  for (unsigned long i = 0; i < n; ++i) {
+    P.col_ind.push_back(i);
+    P.vals.push_back(1.0);
+    P.row_ptr[i + 1] = P.col_ind.size();
+  }
+  for (unsigned long e = 0; e < ends.size(); ++e) {
+    P.col_ind.push_back(ends[e].x);
+    P.col_ind.push_back(ends[e].y);
+    P.vals.push_back(0.5);
+    P.vals.push_back(0.5);
+    P.row_ptr[n + e + 1] = P.col_ind.size();
+  }
+  return fine;
+}
+
 void arta::mesh::construct_mesh(const std::string& source,
                                 const std::string& dest, const double& area,
                                 const double& angle) {
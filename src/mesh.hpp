@@ -13,12 +13,39 @@ namespace mesh {
     Mesh();
     explicit Mesh(const std::string& base_name);
     Mesh(const Mesh& copy);
+    Mesh(Mesh&& other) noexcept = default;
+
+    Mesh& operator=(const Mesh& copy) = default;
+    Mesh& operator=(Mesh&& other) noexcept = default;
 
     double grain_size(const unsigned& e) const;
 
     int locate(const double& x, const double& y) const;
     bool is_boundary(const unsigned& e) const;
 
+    // Largest index distance between two vertices sharing a triangle.
+    unsigned long bandwidth() const;
+
+    // Vertex orders, as new to old index maps.
+    std::vector<unsigned long> rcm_order() const;
+    std::vector<unsigned long> hilbert_order() const;
+    // Triangle order along a Hilbert curve through the centroids.
+    std::vector<unsigned long> tri_order() const;
+
+    // Renumbers vertices and triangles, vert_order[new] = old and
+    // tri_order[new] = old, remapping tri, adj and bdry_index to match.
+    void permute(const std::vector<unsigned long>& vert_order,
+                 const std::vector<unsigned long>& tri_order);
+    // Applies "rcm" (reverse Cuthill-McKee vertices) or "hilbert" (Hilbert
+    // curve vertices) ordering, both with Hilbert ordered triangles.
+    bool reorder(const std::string& method);
+
+    // Uniform refinement, splitting every triangle into four at its edge
+    // midpoints. The vertices keep their indices, the midpoints following
+    // them, and triangle t becomes 4t to 4t + 3. P is set to the P1
+    // prolongation from this mesh to the refined one.
+    Mesh refine(linalg::SparseMatrix& P) const;
+
     std::vector<linalg::Pair<double>> pts;
     std::vector<unsigned long> bdry_index;
     std::vector<linalg::Triple<long>> tri, adj;
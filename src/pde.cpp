@@ -1,10 +1,16 @@
 #include "pde.hpp"
 
+#include <algorithm>
+#include <chrono>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include "alloc.hpp"
 #include "basis.hpp"
 #include "linalg.hpp"
 #include "logger.hpp"
@@ -14,8 +20,6 @@
 #include "script.hpp"
 #include "timer.hpp"
 
-#include <iostream>
-
 arta::PDE::PDE() : script_source() {}
 arta::PDE::PDE(argparse::Arguments args)
     : script_source(args.options["script"]),
@@ -23,11 +27,27 @@ arta::PDE::PDE(argparse::Arguments args)
       mesh_constraints({{args.getf("mesh-area"), args.getf("mesh-angle")}}),
       timer(args.flags["time"]),
       save(!args.flags["no-save"]),
+      text(args.flags["text"]),
+      order(args.options["order"]),
+      refine(args.geti("refine")),
       w(args.geti("res")),
       h(args.geti("res")),
       bg(args.geth("bg")),
       cmap(args.options["cmap"]) {
+  solver.method = args.options["solver"];
+  solver.precond = args.options["precond"];
+  guess = args.options["guess"];
   load_script();
+  // The remaining solver settings of the command line override the
+  // script's.
+  if (args.options["rtol"] != "") solver.rtol = args.getf("rtol");
+  if (args.options["atol"] != "") solver.atol = args.getf("atol");
+  if (args.options["max-iters"] != "") {
+    solver.max_iters = args.geti("max-iters");
+  }
+  if (args.options["check"] != "") solver.check = args.geti("check");
+  if (args.flags["history"]) solver.history = true;
+  if (args.flags["mixed"]) solver.mixed = true;
   load_mesh();
   construct_matrices();
   construct_forcing(0.0);
@@ -47,27 +67,22 @@ void arta::PDE::construct_matrices() {
   // TODO What the actual F**k is going on here???
   if (timer) {
     time::start();
+    alloc::start();
   }
 
-  if (access((dest_dir + "G.mat").c_str(), F_OK) != -1 &&
-      access((dest_dir + "M.mat").c_str(), F_OK) != -1) {
-    G_ = linalg::load_mat_from_file(dest_dir + "G.mat");
-    M_ = linalg::load_mat_from_file(dest_dir + "M.mat");
-    linalg::save_mat_to_file(dest_dir + "Mm.mat", M_);
-  } else {
-    G_ = linalg::Matrix(mesh.pts.size());
-    M_ = linalg::Matrix(mesh.pts.size());
+  if (!load_mat("G", G_) || !load_mat("M", M_)) {
+    G_ = linalg::Matrix(pattern_);
+    M_ = linalg::Matrix(pattern_);
+    std::vector<double>* g_vals = G_.get_vals();
+    std::vector<double>* m_vals = M_.get_vals();
     for (unsigned long ele = 0; ele < mesh.tri.size(); ++ele) {
       for (unsigned long i = 0; i < 3; ++i) {
         for (unsigned long j = 0; j < 3; ++j) {
-          G_.set(mesh.tri[ele][i], mesh.tri[ele][j],
-                 G_.at(mesh.tri[ele][i], mesh.tri[ele][j]) +
-                     calc::integrate(G(ele, i, j), ele, &mesh));
-          M_.set(mesh.tri[ele][i], mesh.tri[ele][j],
-                 M_.at(mesh.tri[ele][i], mesh.tri[ele][j]) +
-                     calc::integrate(A(ele, i, j), ele, &mesh) +
-                     calc::integrate(B(ele, i, j), ele, &mesh) +
-                     calc::integrate(C(ele, i, j), ele, &mesh));
+          unsigned long slot = pattern_->slot(ele, i, j);
+          (*g_vals)[slot] += calc::integrate(G(ele, i, j), ele, &mesh);
+          (*m_vals)[slot] += calc::integrate(A(ele, i, j), ele, &mesh) +
+                             calc::integrate(B(ele, i, j), ele, &mesh) +
+                             calc::integrate(C(ele, i, j), ele, &mesh);
         }
       }
     }
@@ -83,12 +98,13 @@ void arta::PDE::construct_matrices() {
     //   }
     // }
     if (save) {
-      linalg::save_mat_to_file(dest_dir + "G.mat", G_);
-      linalg::save_mat_to_file(dest_dir + "M.mat", M_);
+      save_mat("G", G_);
+      save_mat("M", M_);
     }
   }
   if (timer) {
     log::status("Construct Matricies: %f", time::stop());
+    alloc::report("Construct Matricies");
   }
 }
 
@@ -96,14 +112,23 @@ void arta::PDE::construct_forcing(const double& t) {
   time_ = t;
   if (timer) {
     time::start();
+    alloc::start();
   }
-  if (access((dest_dir + "F.vec").c_str(), F_OK) != -1) {
-    F_ = linalg::load_vec_from_file(dest_dir + "F.vec");
-  } else {
-    F_ = linalg::Vector(mesh.pts.size(), 0.0);
+  if (!load_vec("F", F_)) {
+    if (F_.size() != mesh.pts.size()) {
+      F_ = linalg::Vector(mesh.pts.size());
+    }
+    std::fill(F_.get_vals()->begin(), F_.get_vals()->end(), 0.0);
+    const mesh::Mesh* mesh_ptr = &mesh;
     for (unsigned long ele = 0; ele < mesh.tri.size(); ++ele) {
       for (unsigned long i = 0; i < 3; ++i) {
-        F_[mesh.tri[ele][i]] += calc::integrate(F(ele, i, time_), ele, &mesh);
+        // Same integrand as F(ele, i, time_), without the std::function.
+        F_[mesh.tri[ele][i]] += calc::integrate(
+            [=](double x, double y) {
+              return basis::local(mesh_ptr, x, y, ele, i) *
+                     script::forcing(x, y, time_);
+            },
+            ele, &mesh);
       }
     }
     // for (unsigned i = 0; i < mesh.pts.size(); ++i) {
@@ -113,11 +138,12 @@ void arta::PDE::construct_forcing(const double& t) {
     //   }
     // }
     if (save) {
-      linalg::save_vec_to_file(dest_dir + "F.vec", F_);
+      save_vec("F", F_);
     }
   }
   if (timer) {
     log::status("Construct Forcing: %f", time::stop());
+    alloc::report("Construct Forcing");
   }
 }
 
@@ -125,33 +151,44 @@ void arta::PDE::construct_init() {
   time_ = 0.0;
   if (timer) {
     time::start();
+    alloc::start();
   }
-  if (access((dest_dir + "U0000.vec").c_str(), F_OK) != -1) {
-    U_ = linalg::load_vec_from_file(dest_dir + "U0000.vec");
-  } else {
+  if (!load_vec("U0000", U_)) {
     U_ = linalg::Vector(mesh.pts.size(), 0.0);
     for (unsigned long i = 0; i < mesh.pts.size(); ++i) {
       U_[i] = script::init(mesh.pts[i].x, mesh.pts[i].y);
     }
     if (save) {
-      linalg::save_vec_to_file(dest_dir + "U0000.vec", U_);
+      save_vec("U0000", U_);
     }
   }
   if (timer) {
     log::status("Construct Initial: %f", time::stop());
+    alloc::report("Construct Initial");
   }
 }
 
 void arta::PDE::apply_bc(linalg::Matrix& A) {
+  // Boundary rows are overwritten in place, keeping their stored entries as
+  // explicit zeros so the matrix stays on its shared pattern.
+  const linalg::Matrix& structure = A;
+  const std::vector<unsigned long>* row_ptr = structure.get_row_ptr();
+  const std::vector<unsigned long>* col_ind = structure.get_col_ind();
+  std::vector<double>* vals = A.get_vals();
   for (unsigned i = 0; i < mesh.pts.size(); ++i) {
     if (mesh.is_boundary(i)) {
-      for (unsigned j = 0; j < mesh.pts.size(); ++j) {
-        if (i == j) {
-          A.set(i, j, 1.0);
+      bool has_diag = false;
+      for (unsigned long k = (*row_ptr)[i]; k < (*row_ptr)[i + 1]; ++k) {
+        if ((*col_ind)[k] == i) {
+          (*vals)[k] = 1.0;
+          has_diag = true;
         } else {
-          A.set(i, j, 0.0);
+          (*vals)[k] = 0.0;
         }
       }
+      if (!has_diag) {
+        A.set(i, i, 1.0);
+      }
     }
   }
 }
@@ -170,17 +207,32 @@ arta::linalg::Vector arta::PDE::solve_time_indep() {
   apply_bc(F_);
   if (timer) {
     time::start();
+    alloc::start();
   }
-  if (access((dest_dir + "U.vec").c_str(), F_OK) != -1) {
-    U_ = linalg::load_vec_from_file(dest_dir + "U.vec");
-  } else {
-    U_ = linalg::solve(M_, F_, F_.size());
+  if (!load_vec("U", U_)) {
+    setup_precond(M_);
+    workspace_.resize(F_.size());
+    workspace_.reset();
+    result = linalg::solve(M_, F_, U_, workspace_, solver, precond_.get());
+    log::info("Solve: %u iterations, residual %e", result.iterations,
+              result.residual);
+    if (!result.converged) {
+      log::warning("Solve stopped at residual %e, above %e",
+                   result.residual, result.tolerance);
+    }
+    if (save && solver.history) {
+      linalg::Vector history(result.history.size());
+      std::copy(result.history.begin(), result.history.end(),
+                history.get_vals()->begin());
+      save_vec("residuals", history);
+    }
     if (save) {
-      linalg::save_vec_to_file(dest_dir + "U.vec", U_);
+      save_vec("U", U_);
     }
   }
   if (timer) {
     log::status("Solving Time Indep: %f", time::stop());
+    alloc::report("Solving Time Indep");
   }
   return U_;
 }
@@ -190,39 +242,171 @@ void arta::PDE::solve_time_dep() {
   unsigned N =
       static_cast<unsigned>(script::getd({"tmax", "t_max", "tm"}) / dt);
   construct_init();
-  linalg::Matrix A = G_ + 0.5 * dt * M_;
-  linalg::Matrix B = G_ - 0.5 * dt * M_;
-  std::cout << G_.dump() << "\n\n"
-            << M_.dump() << "\n\n"
-            << (0.5 * dt * M_).dump() << "\n\n";
-  std::cout << A.dump() << "\n\n\n=====\n";
-  std::cout << B.dump() << "\n\n\n=====\n";
-  apply_bc(A);
-  std::vector<linalg::Vector> apxs;
+  init_time_dep(dt);
+  step_iters_ = 0;
+  step_failures_ = 0;
+  // History of U_ for plotting, sized up front so each step only copies.
+  std::vector<linalg::Vector> apxs(N, linalg::Vector(mesh.pts.size()));
+  // Heap traffic of the first step and of all later steps, which should be
+  // allocation free once the first step has sized everything.
+  alloc::Stats first = {0, 0}, rest = {0, 0};
   for (unsigned n = 0; n < N; ++n) {
+    alloc::Stats before = alloc::total();
     // plot_async(dest_dir + fmt_val(n) + ".png", U_, &mesh, w, h, cmap, bg);
-    linalg::Vector F_n = F_;
-    construct_forcing((n + 1) * dt);
-    apxs.push_back(U_);
-    if (access((dest_dir + "U" + fmt_val(n + 1) + ".vec").c_str(), F_OK) !=
-        -1) {
-      U_ = linalg::load_vec_from_file(dest_dir + "U" + arta::fmt_val(n + 1) +
-                                      ".vec");
-    } else {
-      linalg::Vector C = dt / 2.0 * (F_ + F_n);
-      linalg::Vector Q = B * U_ + C;
-      apply_bc(Q);
-      U_ = linalg::solve(A, Q);
-      std::cout << Q.dump() << "\n\n" << U_.dump() << "\n\n";
-      if (save) {
-        linalg::save_vec_to_file(dest_dir + "U" + arta::fmt_val(n + 1) + ".vec",
-                                 U_);
-      }
-    }
+    apxs[n] = U_;
+    step_time_dep(n);
+    alloc::Stats after = alloc::total();
+    alloc::Stats& step = n == 0 ? first : rest;
+    step.count += after.count - before.count;
+    step.bytes += after.bytes - before.bytes;
+  }
+  if (timer) {
+    log::status("Time Loop: %lu solver iterations, %lu unconverged solves",
+                step_iters_, step_failures_);
+  }
+  if (timer && alloc::enabled()) {
+    log::status("Time Loop: first step %lu allocations, %lu bytes", first.count,
+                first.bytes);
+    log::status("Time Loop: later steps %lu allocations, %lu bytes",
+                rest.count, rest.bytes);
   }
   plot_async(dest_dir, apxs, &mesh, w, h, cmap, bg);
 }
 
+std::unique_ptr<arta::linalg::Preconditioner> arta::PDE::make_precond(
+    const std::string& name) const {
+  unsigned index = cycle == "w" ? 2 : 1;
+  if (name == "gmg" && !prolong_.empty()) {
+    return std::unique_ptr<linalg::Preconditioner>(
+        new linalg::GMG(prolong_, smoother, 1, index));
+  } else if (name == "amg" || name == "gmg") {
+    return std::unique_ptr<linalg::Preconditioner>(
+        new linalg::AMG(smoother, 1, index));
+  }
+  return linalg::make_preconditioner(name);
+}
+
+void arta::PDE::setup_precond(const linalg::Matrix& A) {
+  precond_ = make_precond(solver.method == "direct" && solver.mixed
+                              ? "none"
+                              : solver.precond);
+  if (solver.mixed) {
+    // Holds the single precision copy of A along with the inner solve.
+    std::unique_ptr<linalg::Preconditioner> inner = std::move(precond_);
+    precond_.reset(new linalg::MixedPrecision(solver, std::move(inner)));
+  }
+  if (precond_) {
+    precond_->setup(A);
+  }
+}
+
+void arta::PDE::init_time_dep(const double& dt) {
+  dt_ = dt;
+  step_A_.axpby(1.0, G_, 0.5 * dt, M_);
+  step_B_.axpby(1.0, G_, -0.5 * dt, M_);
+  apply_bc(step_A_);
+  // B is symmetric whenever G_ and M_ are, then its product only needs to
+  // stream the upper triangle.
+  step_Bs_ = linalg::symmetric(step_B_) ? linalg::SymMatrix(step_B_)
+                                        : linalg::SymMatrix();
+  workspace_.resize(mesh.pts.size());
+  step_solver_ = solver;
+  step_solver_.guess = guess != "zero";
+  prev_U_ = U_;
+  setup_precond(step_A_);
+}
+
+void arta::PDE::step_time_dep(const unsigned& n) {
+  workspace_.reset();
+  linalg::Vector& F_n = workspace_.acquire();
+  F_n = F_;
+  construct_forcing((n + 1) * dt_);
+  linalg::Vector& U_n = workspace_.acquire();
+  U_n = U_;
+  std::string name = "U" + arta::fmt_val(n + 1);
+  if (!load_vec(name, U_)) {
+    const linalg::Operator& B =
+        step_Bs_.size() != 0 ? static_cast<const linalg::Operator&>(step_Bs_)
+                             : step_B_;
+    linalg::Vector& Q = workspace_.acquire();
+    B.apply(U_, Q);
+    linalg::axpy(dt_ / 2.0, F_, Q);
+    linalg::axpy(dt_ / 2.0, F_n, Q);
+    apply_bc(Q);
+    // The solve starts from U_, which still holds U_n, or from
+    // 2 U_n - U_n-1 once there are two steps to extrapolate from.
+    if (guess == "linear" && n > 0) {
+      linalg::axpby(-1.0, prev_U_, 2.0, U_);
+    }
+    result = linalg::solve(step_A_, Q, U_, workspace_, step_solver_,
+                           precond_.get());
+    step_iters_ += result.iterations;
+    step_failures_ += !result.converged;
+    if (save) {
+      save_vec(name, U_);
+    }
+  }
+  prev_U_ = U_n;
+}
+
+std::string arta::PDE::cache_path(const std::string& name) const {
+  // Cached systems are only valid for the vertex numbering they were built
+  // with, so each mesh ordering and refinement keeps its own files.
+  std::string path = dest_dir + name;
+  if (order != "" && order != "none") {
+    path += "." + order;
+  }
+  if (refine != 0) {
+    path += ".r" + std::to_string(refine);
+  }
+  return path;
+}
+bool arta::PDE::load_mat(const std::string& name, linalg::Matrix& mat) {
+  if (!cache) {
+    return false;
+  }
+  std::string file = cache_path(name) + ".mat";
+  if (access(file.c_str(), F_OK) == -1) {
+    return false;
+  }
+  // A stale or unreadable cache must leave mat untouched.
+  linalg::Matrix loaded = linalg::load_mat_from_file(file);
+  if (loaded.size() != mesh.pts.size()) {
+    return false;
+  }
+  mat = std::move(loaded);
+  return true;
+}
+bool arta::PDE::load_vec(const std::string& name, linalg::Vector& vec) {
+  if (!cache) {
+    return false;
+  }
+  std::string file = cache_path(name) + ".vec";
+  if (access(file.c_str(), F_OK) == -1) {
+    return false;
+  }
+  // A stale or unreadable cache must leave vec untouched, the time loop
+  // falls back to solving from it.
+  linalg::Vector loaded = linalg::load_vec_from_file(file);
+  if (loaded.size() != mesh.pts.size()) {
+    return false;
+  }
+  vec = std::move(loaded);
+  return true;
+}
+void arta::PDE::save_mat(const std::string& name, const linalg::Matrix& mat) {
+  linalg::save_mat_to_file(cache_path(name) + ".mat", mat);
+  if (text) {
+    linalg::export_mat_to_text(cache_path(name) + ".mat.txt", mat);
+  }
+}
+void arta::PDE::save_vec(const std::string& name, const linalg::Vector& vec) {
+  linalg::save_vec_to_file(cache_path(name) + ".vec", vec);
+  if (text) {
+    linalg::export_vec_to_text(cache_path(name) + ".vec.txt", vec);
+  }
+}
+
 double arta::PDE::approx(const double& x, const double& y,
                          const unsigned& e) const {
   double val = 0.0;
@@ -300,10 +484,90 @@ std::function<double(double, double)> arta::PDE::F(const unsigned& e,
 void arta::PDE::load_script() {
   if (timer) {
     time::start();
+    alloc::start();
   }
   script::load_script(script_source);
   if (timer) {
     log::status("Script Load: %f", time::stop());
+    alloc::report("Script Load");
+  }
+  if (script::has("solver") && solver.method == "") {
+    solver.method = script::gets("solver");
+  }
+  if (!linalg::is_solver(solver.method)) {
+    log::warning("Unknown solver \"%s\", using gmres",
+                 solver.method.c_str());
+    solver.method = "gmres";
+  }
+  if (script::has("precond") && solver.precond == "") {
+    solver.precond = script::gets("precond");
+  }
+  if (!linalg::is_preconditioner(solver.precond)) {
+    log::warning("Unknown preconditioner \"%s\", using none",
+                 solver.precond.c_str());
+    solver.precond = "none";
+  }
+  if (script::has("rtol")) solver.rtol = script::getd("rtol");
+  if (script::has("atol")) solver.atol = script::getd("atol");
+  if (script::has("max_iters")) {
+    solver.max_iters = static_cast<unsigned>(script::getd("max_iters"));
+  }
+  if (script::has("check")) {
+    solver.check = static_cast<unsigned>(script::getd("check"));
+  }
+  if (script::has("restart")) {
+    solver.restart = static_cast<unsigned>(script::getd("restart"));
+  }
+  if (script::has("history")) solver.history = script::getd("history") != 0;
+  if (script::has("mixed")) solver.mixed = script::getd("mixed") != 0;
+  if (script::has("refine") && refine == 0) {
+    refine = static_cast<unsigned>(script::getd("refine"));
+  }
+  if (script::has("cycle")) {
+    cycle = script::gets("cycle");
+  }
+  if (cycle != "" && cycle != "v" && cycle != "w") {
+    log::warning("Unknown multigrid cycle \"%s\", using v", cycle.c_str());
+    cycle = "v";
+  }
+  if (script::has("smoother")) {
+    smoother = script::gets("smoother");
+  }
+  if (smoother != "gs" && smoother != "mcgs" && smoother != "jacobi") {
+    log::warning("Unknown multigrid smoother \"%s\", using gs",
+                 smoother.c_str());
+    smoother = "gs";
+  }
+  if (script::has("guess") && guess == "") {
+    guess = script::gets("guess");
+  }
+  if (guess == "") {
+    guess = "previous";
+  } else if (guess != "zero" && guess != "previous" && guess != "linear") {
+    log::warning("Unknown initial guess \"%s\", using previous",
+                 guess.c_str());
+    guess = "previous";
+  }
+  std::string& method = solver.method;
+  std::string& precond = solver.precond;
+  if (refine == 0 && (method == "gmg" || precond == "gmg")) {
+    log::warning("gmg needs a refined mesh, using amg");
+    method = method == "gmg" ? "amg" : method;
+    precond = precond == "gmg" ? "amg" : precond;
+  }
+  if (refine != 0 && method == "" && (precond == "" || precond == "none")) {
+    // The refinements give a nested hierarchy, which multigrid uses far
+    // better than the algebraic one.
+    method = "gmg";
+  }
+  if ((method == "amg" || method == "gmg" || method == "direct") &&
+      (precond == "" || precond == "none")) {
+    // Keeps the hierarchy or factorization for every solve instead of
+    // rebuilding it.
+    precond = method;
+  } else if (method == "mcgs" && (precond == "" || precond == "none")) {
+    // Likewise keeps the coloring.
+    precond = "ssor";
   }
   dest_dir = "./" +
              script_source.substr(
@@ -316,6 +580,9 @@ void arta::PDE::load_mesh() {
   if (script::has("mesh") && mesh_source == "") {
     mesh_source = script::gets("mesh");
   }
+  if (script::has("order") && order == "") {
+    order = script::gets("order");
+  }
   if (script::has("mesh_area") && mesh_constraints[0] == -1) {
     mesh_constraints[0] = script::getd("mesh_area");
   }
@@ -327,6 +594,7 @@ void arta::PDE::load_mesh() {
   if (mesh_source != "") {
     if (timer) {
       time::start();
+      alloc::start();
     }
     std::string mesh_base_name(mesh_source);
     mesh_base_name.erase(0, mesh_base_name.find_last_of("\\/") + 1);
@@ -342,8 +610,30 @@ void arta::PDE::load_mesh() {
     }
     mesh = mesh::Mesh(mesh_dest);
     log::info("Verts: %ld Tris: %ld", mesh.pts.size(), mesh.tri.size());
+    if (order != "" && order != "none") {
+      unsigned long width = timer ? mesh.bandwidth() : 0;
+      time::time_t start = time::now();
+      if (!mesh.reorder(order)) {
+        order = "none";
+      } else if (timer) {
+        double sec = std::chrono::duration<double>(time::now() - start).count();
+        log::status("Reorder (%s): bandwidth %lu -> %lu in %f", order.c_str(),
+                    width, mesh.bandwidth(), sec);
+      }
+    }
+    // Refined levels keep the numbering of the level below, so only the
+    // loaded mesh is reordered.
+    prolong_.assign(refine, linalg::SparseMatrix());
+    for (unsigned r = 0; r < refine; ++r) {
+      mesh = mesh.refine(prolong_[refine - 1 - r]);
+      log::info("Refined %u: Verts: %ld Tris: %ld", r + 1, mesh.pts.size(),
+                mesh.tri.size());
+    }
+    pattern_ =
+        std::make_shared<const linalg::Pattern>(mesh.pts.size(), mesh.tri);
     if (timer) {
       log::status("Mesh Gen/Load: %f", time::stop());
+      alloc::report("Mesh Gen/Load");
     }
   } else {
     log::error("Must define a mesh file either by command line or by script.");
@@ -1,7 +1,9 @@
 #ifndef ARTA_PDE_HPP_
 #define ARTA_PDE_HPP_
 
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "argparse.hpp"
 #include "calc.hpp"
@@ -28,8 +30,17 @@ class PDE {
   void apply_bc(linalg::Vector& b);
 
   linalg::Vector solve_time_indep();
+  // Preconditioner by name, building "amg" and "gmg" with the multigrid
+  // cycle and smoother of the script, "gmg" on the mesh hierarchy of
+  // prolong_.
+  std::unique_ptr<linalg::Preconditioner> make_precond(
+      const std::string& name) const;
 
   void solve_time_dep();
+  // Crank-Nicolson stepping used by solve_time_dep. init_time_dep builds the
+  // step operators for dt, step_time_dep advances U_ from step n to n + 1.
+  void init_time_dep(const double& dt);
+  void step_time_dep(const unsigned& n);
 
   double approx(const double& x, const double& y, const unsigned& e) const;
 
@@ -59,9 +70,29 @@ class PDE {
   linalg::Vector F_, U_;
 
   mesh::Mesh mesh;
+  // Prolongators of the uniform refinements applied to the loaded mesh,
+  // finest first, for geometric multigrid.
+  std::vector<linalg::SparseMatrix> prolong_;
 
   bool timer = false;
   bool save = true;
+  // Reuse systems and solutions cached in dest_dir.
+  bool cache = true;
+  bool text = false;
+  // Mesh ordering applied after loading: "none", "rcm" or "hilbert".
+  std::string order;
+  // Linear solver settings, see linalg::solve, its preconditioner being
+  // built by make_precond. result holds the outcome of the latest solve.
+  linalg::SolverOptions solver;
+  linalg::SolverResult result;
+  // Uniform refinements of the loaded mesh, the multigrid cycle, "v" or
+  // "w", and its smoother, "gs", "mcgs" or "jacobi".
+  unsigned refine = 0;
+  std::string cycle;
+  std::string smoother = "gs";
+  // Initial guess of every time step's solve: "zero", "previous" (U_ of the
+  // last step, the default) or "linear" (extrapolated from the last two).
+  std::string guess;
   unsigned w, h;
   uint32_t bg;
   std::string cmap;
@@ -69,6 +100,30 @@ class PDE {
  private:
   void load_script();
   void load_mesh();
+
+  // Builds precond_ for the solver settings and sets it up on A, wrapped
+  // in a MixedPrecision for mixed precision solves.
+  void setup_precond(const linalg::Matrix& A);
+  std::string cache_path(const std::string& name) const;
+  bool load_mat(const std::string& name, linalg::Matrix& mat);
+  bool load_vec(const std::string& name, linalg::Vector& vec);
+  void save_mat(const std::string& name, const linalg::Matrix& mat);
+  void save_vec(const std::string& name, const linalg::Vector& vec);
+
+  std::shared_ptr<const linalg::Pattern> pattern_;
+
+  double dt_ = 0.0;
+  linalg::Matrix step_A_, step_B_;
+  linalg::SymMatrix step_Bs_;
+  // Scratch vectors of the time loop and its solves, reset every step.
+  linalg::Workspace workspace_;
+  std::unique_ptr<linalg::Preconditioner> precond_;
+  // The solver settings of the time loop, and U_ of the step before last
+  // for the linear guess.
+  linalg::SolverOptions step_solver_;
+  linalg::Vector prev_U_;
+  // Solver iterations and unconverged solves of the time loop.
+  unsigned long step_iters_ = 0, step_failures_ = 0;
 };
 
 double approx(const double& x, const double& y, const unsigned& e,